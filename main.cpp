@@ -7,25 +7,499 @@
 #include <iomanip>
 #include <algorithm>
 #include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <queue>
+#include <functional>
+#include <memory>
+#include <filesystem>
+#include <map>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
+// Process-wide allocation counters for --profile, fed by the replacement
+// global operator new below. They only count while enabled, so without
+// --profile an allocation costs a branch instead of two shared atomic adds.
+struct AllocationCounter {
+    static bool enabled;
+    static atomic<uint64_t> bytes;
+    static atomic<uint64_t> count;
+};
+
+bool AllocationCounter::enabled = false;
+atomic<uint64_t> AllocationCounter::bytes(0);
+atomic<uint64_t> AllocationCounter::count(0);
+
+// Kept out of line: GCC flags free() on a pointer from operator new once the
+// replacement pair is inlined into the same caller.
+#if defined(__GNUC__)
+#define FINSIMX_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define FINSIMX_NOINLINE __declspec(noinline)
+#else
+#define FINSIMX_NOINLINE
+#endif
+
+FINSIMX_NOINLINE void* operator new(size_t size) {
+    if (AllocationCounter::enabled) {
+        AllocationCounter::bytes.fetch_add(size, memory_order_relaxed);
+        AllocationCounter::count.fetch_add(1, memory_order_relaxed);
+    }
+    if (void* p = malloc(size > 0 ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+FINSIMX_NOINLINE void operator delete(void* p) noexcept { free(p); }
+FINSIMX_NOINLINE void operator delete(void* p, size_t) noexcept { free(p); }
+
+// Scoped stage timers for --profile. Each Scope adds its wall time, the bytes
+// allocated while it was open (by any thread) and the bars it processed to
+// its stage's totals. While profiling is off a Scope costs one branch.
+class Profiler {
+public:
+    // Call before any worker threads start
+    static void setEnabled(bool enabled) {
+        active = enabled;
+        AllocationCounter::enabled = enabled;
+    }
+    static bool enabled() { return active; }
+    
+    class Scope {
+    public:
+        explicit Scope(const char* stage, size_t bars = 0)
+            : stage(stage), bars(bars), recording(Profiler::active), bytes(0), allocations(0) {
+            if (recording) {
+                bytes = AllocationCounter::bytes.load(memory_order_relaxed);
+                allocations = AllocationCounter::count.load(memory_order_relaxed);
+                start = chrono::steady_clock::now();
+            }
+        }
+        
+        ~Scope() {
+            if (!recording) return;
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            Profiler::record(stage, seconds, AllocationCounter::bytes.load(memory_order_relaxed) - bytes,
+                             AllocationCounter::count.load(memory_order_relaxed) - allocations, bars);
+        }
+        
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        
+        // For stages that only learn their bar count at the end, e.g. loads
+        void setBars(size_t count) { bars = count; }
+        
+    private:
+        const char* stage;
+        size_t bars;
+        bool recording;
+        uint64_t bytes;
+        uint64_t allocations;
+        chrono::steady_clock::time_point start;
+    };
+    
+    // Prints one row per stage, in the order stages were first seen.
+    static void report(ostream& out) {
+        lock_guard<mutex> lock(stages_mutex);
+        out << "\nProfile (wall time summed over calls; allocations counted process-wide)" << endl;
+        out << left << setw(16) << "Stage" << right << setw(8) << "Calls" << setw(12) << "Time ms"
+            << setw(14) << "Allocated MB" << setw(12) << "Allocs" << setw(14) << "Bars/s" << endl;
+        out << fixed;
+        for (const Stage& stage : stages) {
+            out << left << setw(16) << stage.name << right << setw(8) << stage.calls
+                << setw(12) << setprecision(2) << stage.seconds * 1000
+                << setw(14) << stage.bytes / (1024.0 * 1024.0) << setw(12) << stage.allocations;
+            if (stage.bars > 0 && stage.seconds > 0) {
+                out << setw(14) << setprecision(0) << stage.bars / stage.seconds;
+            } else {
+                out << setw(14) << "-";
+            }
+            out << endl;
+        }
+    }
+    
+    static void reset() {
+        lock_guard<mutex> lock(stages_mutex);
+        stages.clear();
+    }
+    
+private:
+    struct Stage {
+        string name;
+        size_t calls;
+        double seconds;
+        uint64_t bytes;
+        uint64_t allocations;
+        size_t bars;
+    };
+    
+    static void record(const char* name, double seconds, uint64_t bytes, uint64_t allocations, size_t bars) {
+        lock_guard<mutex> lock(stages_mutex);
+        for (Stage& stage : stages) {
+            if (stage.name == name) {
+                stage.calls++;
+                stage.seconds += seconds;
+                stage.bytes += bytes;
+                stage.allocations += allocations;
+                stage.bars += bars;
+                return;
+            }
+        }
+        stages.push_back(Stage{name, 1, seconds, bytes, allocations, bars});
+    }
+    
+    static bool active;
+    static mutex stages_mutex;
+    static vector<Stage> stages;
+};
+
+bool Profiler::active = false;
+mutex Profiler::stages_mutex;
+vector<Profiler::Stage> Profiler::stages;
+
+// Calendar helpers for compact integer timestamps (seconds since the Unix
+// epoch, interpreted as exchange-local wall-clock time).
+class Timestamp {
+public:
+    static const int64_t SECONDS_PER_DAY = 86400;
+    
+    // Days since 1970-01-01 for a proleptic Gregorian date.
+    static int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+        y -= m <= 2;
+        const int64_t era = (y >= 0 ? y : y - 399) / 400;
+        const unsigned yoe = (unsigned)(y - era * 400);
+        const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + (int64_t)doe - 719468;
+    }
+    
+    static void civilFromDays(int64_t z, int& y, unsigned& m, unsigned& d) {
+        z += 719468;
+        const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+        const unsigned doe = (unsigned)(z - era * 146097);
+        const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const unsigned mp = (5 * doy + 2) / 153;
+        d = doy - (153 * mp + 2) / 5 + 1;
+        m = mp < 10 ? mp + 3 : mp - 9;
+        y = (int)(yoe + era * 400 + (m <= 2));
+    }
+    
+    // Parses "YYYY-MM-DD" with an optional " HH:MM[:SS]" or "THH:MM[:SS]"
+    // suffix. Fractional seconds and UTC offsets are ignored.
+    static bool parse(const char* begin, const char* end, int64_t& out) {
+        int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+        const char* p = begin;
+        if (!readInt(p, end, 4, year) || !expect(p, end, '-') ||
+            !readInt(p, end, 2, month) || !expect(p, end, '-') ||
+            !readInt(p, end, 2, day)) {
+            return false;
+        }
+        if (month < 1 || month > 12 || day < 1 || day > 31) return false;
+        
+        if (p < end && (*p == ' ' || *p == 'T')) {
+            ++p;
+            if (!readInt(p, end, 2, hour) || !expect(p, end, ':') || !readInt(p, end, 2, minute)) {
+                return false;
+            }
+            if (p < end && *p == ':') {
+                ++p;
+                if (!readInt(p, end, 2, second)) return false;
+            }
+        }
+        
+        out = daysFromCivil(year, (unsigned)month, (unsigned)day) * SECONDS_PER_DAY
+            + hour * 3600 + minute * 60 + second;
+        return true;
+    }
+    
+    // "YYYY-MM-DD" for midnight timestamps, "YYYY-MM-DD HH:MM:SS" otherwise.
+    static string format(int64_t timestamp) {
+        char buffer[32];
+        format(timestamp, buffer);
+        return buffer;
+    }
+    
+    // Writes the same text into buffer (at least 32 bytes) and returns its
+    // length, without allocating.
+    static size_t format(int64_t timestamp, char* buffer) {
+        int64_t days = timestamp >= 0 ? timestamp / SECONDS_PER_DAY
+                                      : -((-timestamp + SECONDS_PER_DAY - 1) / SECONDS_PER_DAY);
+        int64_t secs = timestamp - days * SECONDS_PER_DAY;
+        int y;
+        unsigned m, d;
+        civilFromDays(days, y, m, d);
+        
+        int length;
+        if (secs == 0) {
+            length = snprintf(buffer, 32, "%04d-%02u-%02u", y, m, d);
+        } else {
+            length = snprintf(buffer, 32, "%04d-%02u-%02u %02d:%02d:%02d", y, m, d,
+                              (int)(secs / 3600), (int)(secs / 60 % 60), (int)(secs % 60));
+        }
+        return (size_t)length;
+    }
+    
+private:
+    static bool readInt(const char*& p, const char* end, int digits, int& value) {
+        if (end - p < digits) return false;
+        value = 0;
+        for (int i = 0; i < digits; ++i) {
+            if (p[i] < '0' || p[i] > '9') return false;
+            value = value * 10 + (p[i] - '0');
+        }
+        p += digits;
+        return true;
+    }
+    
+    static bool expect(const char*& p, const char* end, char c) {
+        if (p >= end || *p != c) return false;
+        ++p;
+        return true;
+    }
+};
+
 struct PriceData {
-    string date;
+    int64_t timestamp;  // seconds since epoch (see Timestamp)
     double open, high, low, close, volume;
     
-    PriceData() : open(0), high(0), low(0), close(0), volume(0) {}
+    PriceData() : timestamp(0), open(0), high(0), low(0), close(0), volume(0) {}
+};
+
+// Read-only view over contiguous elements (a vector, or a memory-mapped
+// column) so indicator code can run on either without copying.
+template <typename T>
+class Span {
+public:
+    Span() : data_(nullptr), size_(0) {}
+    Span(const T* data, size_t size) : data_(data), size_(size) {}
+    Span(const vector<T>& values) : data_(values.data()), size_(values.size()) {}
+    
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const T& operator[](size_t i) const { return data_[i]; }
+    const T& back() const { return data_[size_ - 1]; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+    
+private:
+    const T* data_;
+    size_t size_;
+};
+
+// Non-owning columnar view of a price history, backed by a PriceSeries or a
+// memory-mapped BinaryPriceFile.
+struct PriceView {
+    string symbol;
+    Span<int64_t> timestamp;
+    Span<double> open, high, low, close, volume;
+    
+    size_t size() const { return close.size(); }
+    
+    // One bar, assembled from the columns without copying the series
+    PriceData at(size_t i) const {
+        PriceData bar;
+        bar.timestamp = timestamp[i];
+        bar.open = open[i];
+        bar.high = high[i];
+        bar.low = low[i];
+        bar.close = close[i];
+        bar.volume = volume[i];
+        return bar;
+    }
+    
+    vector<PriceData> toPriceData() const;
+};
+
+// Columnar price history: one contiguous array per field. Timestamps are
+// seconds since the Unix epoch (see Timestamp).
+struct PriceSeries {
+    string symbol;
+    vector<int64_t> timestamp;
+    vector<double> open, high, low, close, volume;
+    size_t skipped_rows = 0;
+    
+    size_t size() const { return close.size(); }
+    
+    void reserve(size_t rows) {
+        timestamp.reserve(rows);
+        open.reserve(rows);
+        high.reserve(rows);
+        low.reserve(rows);
+        close.reserve(rows);
+        volume.reserve(rows);
+    }
+    
+    PriceView view() const {
+        PriceView v;
+        v.symbol = symbol;
+        v.timestamp = timestamp;
+        v.open = open;
+        v.high = high;
+        v.low = low;
+        v.close = close;
+        v.volume = volume;
+        return v;
+    }
+    
+    vector<PriceData> toPriceData() const { return view().toPriceData(); }
+};
+
+enum class TradeAction : uint8_t { Hold, Buy, Sell };
+
+inline const char* actionName(TradeAction action) {
+    switch (action) {
+        case TradeAction::Buy: return "BUY";
+        case TradeAction::Sell: return "SELL";
+        default: return "HOLD";
+    }
+}
+
+// Built-in signal reasons; ReasonTable assigns further IDs on demand.
+enum SignalReason : uint16_t {
+    REASON_NO_SIGNAL,
+    REASON_WARMING_UP,
+    REASON_STOP_LOSS,
+    REASON_TAKE_PROFIT,
+    REASON_STRONG_OVERSOLD,
+    REASON_MACD_CROSSOVER,
+    REASON_BB_BOUNCE,
+    REASON_RSI_OVERSOLD_UPTREND,
+    REASON_RSI_OVERBOUGHT,
+    REASON_MACD_BEARISH_CROSSOVER,
+    REASON_TREND_REVERSAL,
+    REASON_RSI_MEAN_REVERSION,
+    REASON_RSI_NEUTRAL_EXIT,
+    BUILTIN_REASON_COUNT
+};
+
+// Interned signal reason strings. Records carry a 16-bit ID instead of a
+// string; the text is only looked up when printing.
+class ReasonTable {
+public:
+    static uint16_t intern(const string& text) {
+        lock_guard<mutex> lock(tableMutex());
+        deque<string>& names = table();
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (names[i] == text) return (uint16_t)i;
+        }
+        if (names.size() > 0xFFFF) {
+            throw runtime_error("Too many distinct signal reasons");
+        }
+        names.push_back(text);
+        return (uint16_t)(names.size() - 1);
+    }
+    
+    static string name(uint16_t id) {
+        lock_guard<mutex> lock(tableMutex());
+        const deque<string>& names = table();
+        return id < names.size() ? names[id] : string("Unknown");
+    }
+    
+private:
+    static mutex& tableMutex() {
+        static mutex m;
+        return m;
+    }
+    
+    static deque<string>& table() {
+        static deque<string> names = {
+            "No signal",
+            "Warming up",
+            "Stop Loss",
+            "Take Profit",
+            "Strong Oversold + MACD Bull + Uptrend",
+            "MACD Crossover + RSI Neutral + Uptrend",
+            "BB Lower Bounce + RSI Oversold",
+            "RSI Oversold + Uptrend + MACD Improving",
+            "RSI Overbought + MACD Bearish",
+            "MACD Bearish Crossover",
+            "Trend Reversal",
+            "RSI Oversold + Price Turning Up",
+            "RSI Back Above Neutral",
+        };
+        return names;
+    }
 };
 
+// Compact POD record of one bar's decision.
 struct TradingSignal {
-    string date;
-    string action;
+    int64_t timestamp;
+    uint32_t bar;              // Index of the bar within its run
+    TradeAction action;
+    uint16_t reason;           // ReasonTable ID
     double price;
     double rsi;
     double macd;
     double signal;
     double portfolio_value;
-    string reason;
+    
+    string date() const { return Timestamp::format(timestamp); }
+    string reasonText() const { return ReasonTable::name(reason); }
+};
+
+// History of one backtest run: a dense equity curve (one double per bar)
+// plus a sparse list of fills, so HOLD bars never cost a full record.
+// clear() keeps the capacity, so a log reused across runs stops allocating
+// once it has seen the longest run.
+class TradeLog {
+public:
+    void clear() {
+        equity_.clear();
+        fills_.clear();
+    }
+    
+    void reserve(size_t bars, size_t fills = 64) {
+        equity_.reserve(bars);
+        fills_.reserve(fills);
+    }
+    
+    void record(const TradingSignal& signal) {
+        equity_.push_back(signal.portfolio_value);
+        if (signal.action != TradeAction::Hold) {
+            fills_.push_back(signal);
+        }
+    }
+    
+    // Appends count HOLD bars at the given portfolio value.
+    void recordHold(double portfolio_value, size_t count = 1) {
+        equity_.insert(equity_.end(), count, portfolio_value);
+    }
+    
+    void recordHolds(const double* portfolio_values, size_t count) {
+        equity_.insert(equity_.end(), portfolio_values, portfolio_values + count);
+    }
+    
+    bool empty() const { return equity_.empty(); }
+    size_t bars() const { return equity_.size(); }
+    const vector<double>& equity() const { return equity_; }
+    const vector<TradingSignal>& fills() const { return fills_; }
+    
+private:
+    vector<double> equity_;
+    vector<TradingSignal> fills_;
 };
 
 struct MACDResult {
@@ -34,491 +508,6166 @@ struct MACDResult {
     vector<double> histogram;
 };
 
-class TechnicalIndicators {
+struct BollingerResult {
+    vector<double> middle;
+    vector<double> upper;
+    vector<double> lower;
+    vector<double> stddev;
+};
+
+// Tunable knobs of AdvancedTradingStrategy. Defaults match the original
+// hard-coded strategy.
+struct StrategyParams {
+    double rsi_oversold = 25.0;      // More aggressive oversold
+    double rsi_overbought = 75.0;    // More aggressive overbought
+    double rsi_neutral_low = 45.0;   // RSI neutral zone
+    double rsi_neutral_high = 55.0;  // RSI neutral zone
+    
+    // Risk management
+    double stop_loss_pct = 0.08;     // 8% stop loss
+    double take_profit_pct = 0.12;   // 12% take profit
+    double position_size_pct = 0.90; // Use 90% of available cash
+    int max_consecutive_losses = 3;
+    
+    int rule_set = 0;                // Entry/exit rules (see StrategyCatalog)
+    
+    // Sets a knob by name; returns false for unknown names.
+    bool set(const string& name, double value) {
+        if (name == "rsi_oversold") rsi_oversold = value;
+        else if (name == "rsi_overbought") rsi_overbought = value;
+        else if (name == "stop_loss_pct") stop_loss_pct = value;
+        else if (name == "take_profit_pct") take_profit_pct = value;
+        else if (name == "position_size_pct") position_size_pct = value;
+        else if (name == "max_consecutive_losses") max_consecutive_losses = (int)lround(value);
+        else if (name == "rule_set") rule_set = (int)lround(value);
+        else return false;
+        return true;
+    }
+};
+
+// Values of every strategy indicator at a single bar.
+struct IndicatorSnapshot {
+    double close = 0.0;
+    double rsi = 50.0;
+    double rsi_short = 50.0;
+    double macd = 0.0;
+    double macd_signal = 0.0;
+    double macd_histogram = 0.0;
+    double sma_20 = 0.0;
+    double sma_50 = 0.0;
+    double bb_lower = 0.0;
+};
+
+// Indicator series used by AdvancedTradingStrategy, stored structure-of-arrays
+// in one contiguous block (column-major, one column per series). None of them
+// depend on StrategyParams, so one set can be shared read-only by many
+// backtests. The block only grows, so a set reused across symbols stops
+// allocating once it has seen the longest series.
+class IndicatorSet {
 public:
-    static vector<double> calculateSMA(const vector<double>& prices, int period) {
-        vector<double> sma(prices.size(), 0.0);
-        if (prices.size() < (size_t)period) return sma;
-        
-        for (size_t i = period - 1; i < prices.size(); ++i) {
-            double sum = 0.0;
-            for (int j = 0; j < period; ++j) {
-                sum += prices[i - j];
+    enum Column {
+        CLOSE,
+        RSI,             // RSI(14)
+        RSI_SHORT,       // RSI(7)
+        MACD,            // MACD(12, 26)
+        MACD_SIGNAL,     // EMA(9) of MACD
+        MACD_HISTOGRAM,
+        SMA_20,
+        SMA_50,
+        BB_LOWER,        // BB(20, 2.0) lower band
+        COLUMN_COUNT
+    };
+    
+    IndicatorSet() : rows(0) {}
+    
+    void resize(size_t row_count) {
+        rows = row_count;
+        if (storage.size() < rows * COLUMN_COUNT) {
+            storage.resize(rows * COLUMN_COUNT);
+        }
+    }
+    
+    size_t size() const { return rows; }
+    
+    double* column(Column c) { return storage.data() + c * rows; }
+    Span<double> column(Column c) const { return Span<double>(storage.data() + c * rows, rows); }
+    
+    Span<double> close() const { return column(CLOSE); }
+    Span<double> rsi() const { return column(RSI); }
+    Span<double> rsiShort() const { return column(RSI_SHORT); }
+    Span<double> macd() const { return column(MACD); }
+    Span<double> macdSignal() const { return column(MACD_SIGNAL); }
+    Span<double> macdHistogram() const { return column(MACD_HISTOGRAM); }
+    Span<double> sma20() const { return column(SMA_20); }
+    Span<double> sma50() const { return column(SMA_50); }
+    Span<double> bbLower() const { return column(BB_LOWER); }
+    
+    IndicatorSnapshot at(size_t i) const {
+        const double* base = storage.data() + i;
+        IndicatorSnapshot snapshot;
+        snapshot.close = base[CLOSE * rows];
+        snapshot.rsi = base[RSI * rows];
+        snapshot.rsi_short = base[RSI_SHORT * rows];
+        snapshot.macd = base[MACD * rows];
+        snapshot.macd_signal = base[MACD_SIGNAL * rows];
+        snapshot.macd_histogram = base[MACD_HISTOGRAM * rows];
+        snapshot.sma_20 = base[SMA_20 * rows];
+        snapshot.sma_50 = base[SMA_50 * rows];
+        snapshot.bb_lower = base[BB_LOWER * rows];
+        return snapshot;
+    }
+    
+    void set(size_t i, const IndicatorSnapshot& snapshot) {
+        double* base = storage.data() + i;
+        base[CLOSE * rows] = snapshot.close;
+        base[RSI * rows] = snapshot.rsi;
+        base[RSI_SHORT * rows] = snapshot.rsi_short;
+        base[MACD * rows] = snapshot.macd;
+        base[MACD_SIGNAL * rows] = snapshot.macd_signal;
+        base[MACD_HISTOGRAM * rows] = snapshot.macd_histogram;
+        base[SMA_20 * rows] = snapshot.sma_20;
+        base[SMA_50 * rows] = snapshot.sma_50;
+        base[BB_LOWER * rows] = snapshot.bb_lower;
+    }
+    
+private:
+    size_t rows;
+    vector<double> storage;
+};
+
+struct PerformanceMetrics {
+    bool has_history = false;
+    double initial_capital = 0.0;
+    double final_value = 0.0;
+    double total_return = 0.0;
+    double buy_hold_return = 0.0;
+    double sharpe = 0.0;
+    double sortino = 0.0;
+    double max_drawdown = 0.0;
+    size_t max_drawdown_bars = 0;    // Longest stretch below the running peak
+    double exposure = 0.0;           // Fraction of bars holding a position
+    double turnover = 0.0;           // Traded notional / average portfolio value
+    int buy_trades = 0;
+    int sell_trades = 0;
+    double win_rate = 0.0;
+    double cash = 0.0;
+    double shares = 0.0;
+    double unrealized_pnl = 0.0;
+    
+    double alpha() const { return total_return - buy_hold_return; }
+};
+
+// Single-pass performance statistics, updated bar by bar and fill by fill so
+// no per-bar history is needed. Period returns use Welford's update. merge()
+// appends another accumulator as if its run continued from this one's final
+// value (e.g. consecutive walk-forward windows, or pieces of a run computed
+// on different threads); the other run's curve is rescaled by its own
+// initial capital.
+class MetricsAccumulator {
+public:
+    static constexpr double PERIODS_PER_YEAR = 252.0;
+    
+    explicit MetricsAccumulator(double initial_capital = 0.0) { reset(initial_capital); }
+    
+    void reset(double initial_capital) {
+        initial = initial_capital;
+        bar_count = 0;
+        first_equity = last_equity = min_equity = 0.0;
+        peak = initial_capital;
+        max_dd = 0.0;
+        underwater = longest_underwater = leading_underwater = 0;
+        recovered = false;
+        return_count = 0;
+        return_mean = return_m2 = downside_sq = 0.0;
+        bars_in_market = 0;
+        equity_sum = traded_notional = 0.0;
+        buys = sells = wins = 0;
+        last_buy_price = 0.0;
+    }
+    
+    // Portfolio value at the close of a bar and the market value of the
+    // position held over it.
+    void addBar(double equity, double market_value) {
+        if (bar_count == 0) {
+            first_equity = min_equity = equity;
+        } else if (last_equity > 0) {
+            addReturn((equity - last_equity) / last_equity);
+        }
+        trackEquity(equity, market_value);
+    }
+    
+    // Same as addBar() for each of count bars, except that the block's
+    // returns are summed (shifted by the first one) and merged in as a group,
+    // which keeps Welford's serial divisions out of the loop. The mean and
+    // variance can differ from bar-by-bar updates in the last bits.
+    void addBars(const double* equity, const double* market_value, size_t count) {
+        double shift = 0.0, sum = 0.0, sum_sq = 0.0, downside = 0.0;
+        size_t returns = 0;
+        for (size_t j = 0; j < count; ++j) {
+            if (bar_count == 0) {
+                first_equity = min_equity = equity[j];
+            } else if (last_equity > 0) {
+                double r = (equity[j] - last_equity) / last_equity;
+                if (returns == 0) shift = r;
+                double d = r - shift;
+                sum += d;
+                sum_sq += d * d;
+                double loss = min(r, 0.0);   // Branchless: the sign is a coin flip
+                downside += loss * loss;
+                returns++;
             }
-            sma[i] = sum / period;
+            trackEquity(equity[j], market_value[j]);
         }
-        return sma;
+        if (returns == 0) return;
+        
+        double mean = shift + sum / returns;
+        double m2 = max(0.0, sum_sq - sum * sum / returns);
+        double total = (double)(return_count + returns);
+        double delta = mean - return_mean;
+        return_m2 += m2 + delta * delta * return_count * returns / total;
+        return_mean += delta * returns / total;
+        return_count += returns;
+        downside_sq += downside;
     }
-    static vector<double> calculateEMA(const vector<double>& prices, int period) {
-        vector<double> ema(prices.size(), 0.0);
-        if (prices.empty()) return ema;
+    
+    // Same as count calls to addBar(equity, 0.0), in O(1): a flat stretch
+    // after the first bar only adds zero returns and cannot set a new peak.
+    void addFlatBars(size_t count, double equity) {
+        if (count == 0) return;
+        addBar(equity, 0.0);
+        size_t rest = count - 1;
+        if (rest == 0) return;
         
-        double multiplier = 2.0 / (period + 1);
-        ema[0] = prices[0];
+        if (last_equity > 0) {
+            double total = (double)(return_count + rest);
+            return_m2 += return_mean * return_mean * return_count * rest / total;
+            return_mean -= return_mean * rest / total;
+            return_count += rest;
+        }
+        bar_count += rest;
+        equity_sum += equity * rest;
+        if (equity < peak) {
+            underwater += rest;
+            if (!recovered) leading_underwater += rest;
+            longest_underwater = max(longest_underwater, underwater);
+        }
+    }
+    
+    // A sale counts as a win when it is above the most recent purchase price.
+    void addFill(TradeAction action, double price, double shares) {
+        traded_notional += price * shares;
+        if (action == TradeAction::Buy) {
+            buys++;
+            last_buy_price = price;
+        } else if (action == TradeAction::Sell && last_buy_price > 0) {
+            sells++;
+            if (price - last_buy_price > 0) wins++;
+        }
+    }
+    
+    void merge(const MetricsAccumulator& other) {
+        if (other.bar_count == 0) return;
+        if (bar_count == 0) {
+            *this = other;
+            return;
+        }
         
-        for (size_t i = 1; i < prices.size(); ++i) {
-            ema[i] = (prices[i] * multiplier) + (ema[i - 1] * (1 - multiplier));
+        double scale = other.initial > 0 ? last_equity / other.initial : 1.0;
+        
+        // Return across the seam, then the other run's returns (Chan et al.)
+        if (other.initial > 0) addReturn(other.first_equity / other.initial - 1.0);
+        if (other.return_count > 0) {
+            double total = (double)(return_count + other.return_count);
+            double delta = other.return_mean - return_mean;
+            return_m2 += other.return_m2 + delta * delta * return_count * other.return_count / total;
+            return_mean += delta * other.return_count / total;
+            return_count += other.return_count;
+            downside_sq += other.downside_sq;
         }
         
-        return ema;
+        // The other run's lowest point against this run's peak is exact: if
+        // it came after a new high, other.max_dd already covers it.
+        if (peak > 0) max_dd = max(max_dd, (peak - other.min_equity * scale) / peak);
+        max_dd = max(max_dd, other.max_dd);
+        
+        // Durations are a lower bound when this run ends under water, since
+        // the other run only tracks recovery to its own starting value.
+        if (underwater > 0) longest_underwater = max(longest_underwater, underwater + other.leading_underwater);
+        longest_underwater = max(longest_underwater, other.longest_underwater);
+        underwater = other.recovered ? other.underwater : underwater + other.bar_count;
+        peak = max(peak, other.peak * scale);
+        
+        min_equity = min(min_equity, other.min_equity * scale);
+        last_equity = other.last_equity * scale;
+        bar_count += other.bar_count;
+        equity_sum += other.equity_sum * scale;
+        bars_in_market += other.bars_in_market;
+        traded_notional += other.traded_notional * scale;
+        buys += other.buys;
+        sells += other.sells;
+        wins += other.wins;
+        if (other.buys > 0) last_buy_price = other.last_buy_price;
     }
     
-    static vector<double> calculateRSI(const vector<double>& prices, int period = 14) {
-        vector<double> rsi(prices.size(), 50.0);
-        if (prices.size() <= (size_t)period) return rsi;
+    size_t bars() const { return bar_count; }
+    double initialCapital() const { return initial; }
+    double finalValue() const { return last_equity; }
+    
+    double sharpe() const {
+        double stddev = return_count > 0 ? sqrt(return_m2 / return_count) : 0.0;
+        return stddev > 0 ? (return_mean * PERIODS_PER_YEAR) / (stddev * sqrt(PERIODS_PER_YEAR)) : 0.0;
+    }
+    
+    double sortino() const {
+        double downside = return_count > 0 ? sqrt(downside_sq / return_count) : 0.0;
+        return downside > 0 ? (return_mean * PERIODS_PER_YEAR) / (downside * sqrt(PERIODS_PER_YEAR)) : 0.0;
+    }
+    
+    double maxDrawdown() const { return max_dd; }
+    size_t maxDrawdownBars() const { return longest_underwater; }
+    
+    // Fraction of bars with a position open
+    double exposure() const { return bar_count > 0 ? (double)bars_in_market / bar_count : 0.0; }
+    
+    // Traded notional divided by the average portfolio value
+    double turnover() const {
+        return equity_sum > 0 ? traded_notional / (equity_sum / bar_count) : 0.0;
+    }
+    
+    int buyTrades() const { return buys; }
+    int sellTrades() const { return sells; }
+    double winRate() const { return buys > 0 ? (double)wins / buys * 100 : 0.0; }
+    
+private:
+    // Everything addBar() tracks except the period return
+    void trackEquity(double equity, double market_value) {
+        last_equity = equity;
+        min_equity = min(min_equity, equity);
+        bar_count++;
+        equity_sum += equity;
+        if (market_value > 0) bars_in_market++;
         
-        vector<double> gains, losses;
-        for (size_t i = 1; i < prices.size(); ++i) {
-            double change = prices[i] - prices[i - 1];
-            gains.push_back(change > 0 ? change : 0);
-            losses.push_back(change < 0 ? -change : 0);
+        if (equity >= peak) {
+            peak = equity;
+            underwater = 0;
+            recovered = true;
+        } else {
+            underwater++;
+            if (!recovered) leading_underwater++;
+            longest_underwater = max(longest_underwater, underwater);
+            if (peak > 0) max_dd = max(max_dd, (peak - equity) / peak);
+        }
+    }
+    
+    void addReturn(double r) {
+        return_count++;
+        double delta = r - return_mean;
+        return_mean += delta / return_count;
+        return_m2 += delta * (r - return_mean);
+        if (r < 0) downside_sq += r * r;
+    }
+    
+    double initial;
+    size_t bar_count;
+    double first_equity, last_equity, min_equity;
+    double peak;
+    double max_dd;
+    size_t underwater, longest_underwater, leading_underwater;
+    bool recovered;
+    size_t return_count;
+    double return_mean, return_m2, downside_sq;
+    size_t bars_in_market;
+    double equity_sum, traded_notional;
+    int buys, sells, wins;
+    double last_buy_price;
+};
+
+// Raw native-endian field I/O for the indicator checkpoints (saveState /
+// loadState) written by IndicatorCache.
+template <typename T>
+static inline void writeRaw(ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static inline void readRaw(istream& in, T& value) {
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+// Sliding-window mean and population variance in O(1) per sample.
+// Once the window is full each push replaces the oldest sample with a Welford
+// update; the window is re-summed from scratch every RESYNC_INTERVAL pushes so
+// rounding drift stays bounded on long series.
+class RollingStats {
+public:
+    static const size_t RESYNC_INTERVAL = 4096;
+    
+    explicit RollingStats(int period)
+        : period(period > 0 ? period : 1), window(this->period, 0.0) {
+        reset();
+    }
+    
+    void reset() {
+        head = 0;
+        count = 0;
+        since_resync = 0;
+        mean_ = 0.0;
+        m2 = 0.0;
+    }
+    
+    void push(double x) {
+        if (count < (size_t)period) {
+            window[head] = x;
+            head = (head + 1) % period;
+            count++;
+            double delta = x - mean_;
+            mean_ += delta / count;
+            m2 += delta * (x - mean_);
+            return;
         }
         
-        double avg_gain = 0.0, avg_loss = 0.0;
-        for (int i = 0; i < period; ++i) {
-            avg_gain += gains[i];
-            avg_loss += losses[i];
+        double old = window[head];
+        window[head] = x;
+        head = (head + 1) % period;
+        
+        if (++since_resync >= RESYNC_INTERVAL) {
+            resync();
+            return;
         }
-        avg_gain /= period;
-        avg_loss /= period;
         
-        for (size_t i = period; i < prices.size(); ++i) {
-            if (i - 1 < gains.size()) {
-                avg_gain = (avg_gain * (period - 1) + gains[i - 1]) / period;
-                avg_loss = (avg_loss * (period - 1) + losses[i - 1]) / period;
-                
-                if (avg_loss == 0) {
-                    rsi[i] = 100.0;
-                } else {
-                    rsi[i] = 100.0 - (100.0 / (1.0 + (avg_gain / avg_loss)));
-                }
-            }
+        double old_mean = mean_;
+        mean_ += (x - old) / period;
+        m2 += (x - old) * ((x - mean_) + (old - old_mean));
+        if (m2 < 0.0) m2 = 0.0;
+    }
+    
+    bool ready() const { return count >= (size_t)period; }
+    int getPeriod() const { return period; }
+    double mean() const { return mean_; }
+    double variance() const { return count > 0 ? m2 / count : 0.0; }
+    double stddev() const { return sqrt(variance()); }
+    
+    void saveState(ostream& out) const {
+        writeRaw(out, period);
+        out.write(reinterpret_cast<const char*>(window.data()), window.size() * sizeof(double));
+        writeRaw(out, head);
+        writeRaw(out, count);
+        writeRaw(out, since_resync);
+        writeRaw(out, mean_);
+        writeRaw(out, m2);
+    }
+    
+    void loadState(istream& in) {
+        int saved_period = 0;
+        readRaw(in, saved_period);
+        if (saved_period != period) {
+            throw runtime_error("Indicator checkpoint has a different window length");
+        }
+        in.read(reinterpret_cast<char*>(window.data()), window.size() * sizeof(double));
+        readRaw(in, head);
+        readRaw(in, count);
+        readRaw(in, since_resync);
+        readRaw(in, mean_);
+        readRaw(in, m2);
+    }
+    
+private:
+    // Exact two-pass recomputation over the current window.
+    void resync() {
+        since_resync = 0;
+        double sum = 0.0;
+        for (double v : window) sum += v;
+        mean_ = sum / period;
+        m2 = 0.0;
+        for (double v : window) m2 += (v - mean_) * (v - mean_);
+    }
+    
+    int period;
+    vector<double> window;
+    size_t head;
+    size_t count;
+    size_t since_resync;
+    double mean_;
+    double m2;
+};
+
+// Exponential moving average, one sample at a time. Seeds with the first
+// sample, matching TechnicalIndicators::calculateEMA.
+class EMAState {
+public:
+    explicit EMAState(int period) : multiplier(2.0 / (period + 1)) { reset(); }
+    
+    void reset() {
+        value_ = 0.0;
+        seeded = false;
+    }
+    
+    double update(double x) {
+        if (!seeded) {
+            value_ = x;
+            seeded = true;
+        } else {
+            value_ = (x * multiplier) + (value_ * (1 - multiplier));
+        }
+        return value_;
+    }
+    
+    double value() const { return value_; }
+    
+    void saveState(ostream& out) const {
+        writeRaw(out, value_);
+        writeRaw(out, seeded);
+    }
+    
+    void loadState(istream& in) {
+        readRaw(in, value_);
+        readRaw(in, seeded);
+    }
+    
+private:
+    double multiplier;
+    double value_;
+    bool seeded;
+};
+
+// Wilder-smoothed RSI, one sample at a time. Reproduces
+// TechnicalIndicators::calculateRSI exactly, including its 50.0 warm-up
+// value and its seeding (the period-th change is also the first smoothing
+// step).
+class WilderRSIState {
+public:
+    explicit WilderRSIState(int period) : period(period) { reset(); }
+    
+    void reset() {
+        count = 0;
+        prev_price = 0.0;
+        avg_gain = 0.0;
+        avg_loss = 0.0;
+        value_ = 50.0;
+    }
+    
+    double update(double price) {
+        if (count++ == 0) {
+            prev_price = price;
+            return value_;
+        }
+        
+        double change = price - prev_price;
+        prev_price = price;
+        double gain = change > 0 ? change : 0;
+        double loss = change < 0 ? -change : 0;
+        
+        size_t changes = count - 1;
+        if (changes <= (size_t)period) {
+            avg_gain += gain;
+            avg_loss += loss;
+            if (changes < (size_t)period) return value_;
+            avg_gain /= period;
+            avg_loss /= period;
+        }
+        
+        avg_gain = (avg_gain * (period - 1) + gain) / period;
+        avg_loss = (avg_loss * (period - 1) + loss) / period;
+        if (avg_loss == 0) {
+            value_ = 100.0;
+        } else {
+            value_ = 100.0 - (100.0 / (1.0 + (avg_gain / avg_loss)));
+        }
+        return value_;
+    }
+    
+    double value() const { return value_; }
+    
+    void saveState(ostream& out) const {
+        writeRaw(out, count);
+        writeRaw(out, prev_price);
+        writeRaw(out, avg_gain);
+        writeRaw(out, avg_loss);
+        writeRaw(out, value_);
+    }
+    
+    void loadState(istream& in) {
+        readRaw(in, count);
+        readRaw(in, prev_price);
+        readRaw(in, avg_gain);
+        readRaw(in, avg_loss);
+        readRaw(in, value_);
+    }
+    
+private:
+    int period;
+    size_t count;
+    double prev_price;
+    double avg_gain;
+    double avg_loss;
+    double value_;
+};
+
+// MACD line, signal line and histogram, one sample at a time.
+class MACDState {
+public:
+    MACDState(int fast_period = 12, int slow_period = 26, int signal_period = 9)
+        : ema_fast(fast_period), ema_slow(slow_period), ema_signal(signal_period) { reset(); }
+    
+    void reset() {
+        ema_fast.reset();
+        ema_slow.reset();
+        ema_signal.reset();
+        macd = signal = histogram = 0.0;
+    }
+    
+    void update(double price) {
+        macd = ema_fast.update(price) - ema_slow.update(price);
+        signal = ema_signal.update(macd);
+        histogram = macd - signal;
+    }
+    
+    void saveState(ostream& out) const {
+        ema_fast.saveState(out);
+        ema_slow.saveState(out);
+        ema_signal.saveState(out);
+        writeRaw(out, macd);
+        writeRaw(out, signal);
+        writeRaw(out, histogram);
+    }
+    
+    void loadState(istream& in) {
+        ema_fast.loadState(in);
+        ema_slow.loadState(in);
+        ema_signal.loadState(in);
+        readRaw(in, macd);
+        readRaw(in, signal);
+        readRaw(in, histogram);
+    }
+    
+    double macd;
+    double signal;
+    double histogram;
+    
+private:
+    EMAState ema_fast;
+    EMAState ema_slow;
+    EMAState ema_signal;
+};
+
+// Every strategy indicator advanced by one bar per update() in O(1) time with
+// no allocation after construction. Produces the same values as the batch
+// TechnicalIndicators functions at the same bar index.
+class StreamingIndicators {
+public:
+    StreamingIndicators()
+        : rsi(14), rsi_short(7), macd(12, 26, 9), window_20(20), window_50(50) {}
+    
+    void reset() {
+        rsi.reset();
+        rsi_short.reset();
+        macd.reset();
+        window_20.reset();
+        window_50.reset();
+    }
+    
+    IndicatorSnapshot update(double price) {
+        IndicatorSnapshot snapshot;
+        snapshot.close = price;
+        snapshot.rsi = rsi.update(price);
+        snapshot.rsi_short = rsi_short.update(price);
+        
+        macd.update(price);
+        snapshot.macd = macd.macd;
+        snapshot.macd_signal = macd.signal;
+        snapshot.macd_histogram = macd.histogram;
+        
+        // SMA20 and the 20-bar Bollinger band share one window
+        window_20.push(price);
+        window_50.push(price);
+        if (window_20.ready()) {
+            snapshot.sma_20 = window_20.mean();
+            snapshot.bb_lower = window_20.mean() - (window_20.stddev() * 2.0);
+        }
+        if (window_50.ready()) {
+            snapshot.sma_50 = window_50.mean();
+        }
+        return snapshot;
+    }
+    
+    // Identifies the indicators and periods computed above; checkpoints
+    // saved under another signature are not reused.
+    static const char* signature() {
+        return "rsi(14);rsi(7);macd(12,26,9);sma(20);sma(50);bb_lower(20,2.0)";
+    }
+    
+    // Everything update() depends on, so a restored state continues a
+    // series exactly where the saved one stopped.
+    void saveState(ostream& out) const {
+        rsi.saveState(out);
+        rsi_short.saveState(out);
+        macd.saveState(out);
+        window_20.saveState(out);
+        window_50.saveState(out);
+    }
+    
+    void loadState(istream& in) {
+        rsi.loadState(in);
+        rsi_short.loadState(in);
+        macd.loadState(in);
+        window_20.loadState(in);
+        window_50.loadState(in);
+        if (!in) {
+            throw runtime_error("Truncated indicator checkpoint");
+        }
+    }
+    
+private:
+    WilderRSIState rsi;
+    WilderRSIState rsi_short;
+    MACDState macd;
+    RollingStats window_20;
+    RollingStats window_50;
+};
+
+// Computes every IndicatorSet column in a single pass over the closes.
+// Output is bit-identical to the individual TechnicalIndicators functions.
+// Reusing one engine and one IndicatorSet across symbols avoids all
+// per-symbol allocation.
+class IndicatorEngine {
+public:
+    void compute(Span<double> close, IndicatorSet& out) {
+        computeFrom(close.size(), [&](size_t i) { return close[i]; }, out);
+    }
+    
+    void compute(const vector<PriceData>& price_data, IndicatorSet& out) {
+        computeFrom(price_data.size(), [&](size_t i) { return price_data[i].close; }, out);
+    }
+    
+    void compute(const PriceView& bars, IndicatorSet& out) { compute(bars.close, out); }
+    
+private:
+    template <typename CloseAt>
+    void computeFrom(size_t n, CloseAt close_at, IndicatorSet& out) {
+        Profiler::Scope scope("indicators", n);
+        stream.reset();
+        out.resize(n);
+        double* close = out.column(IndicatorSet::CLOSE);
+        double* rsi = out.column(IndicatorSet::RSI);
+        double* rsi_short = out.column(IndicatorSet::RSI_SHORT);
+        double* macd = out.column(IndicatorSet::MACD);
+        double* macd_signal = out.column(IndicatorSet::MACD_SIGNAL);
+        double* macd_histogram = out.column(IndicatorSet::MACD_HISTOGRAM);
+        double* sma_20 = out.column(IndicatorSet::SMA_20);
+        double* sma_50 = out.column(IndicatorSet::SMA_50);
+        double* bb_lower = out.column(IndicatorSet::BB_LOWER);
+        
+        for (size_t i = 0; i < n; ++i) {
+            IndicatorSnapshot snapshot = stream.update(close_at(i));
+            close[i] = snapshot.close;
+            rsi[i] = snapshot.rsi;
+            rsi_short[i] = snapshot.rsi_short;
+            macd[i] = snapshot.macd;
+            macd_signal[i] = snapshot.macd_signal;
+            macd_histogram[i] = snapshot.macd_histogram;
+            sma_20[i] = snapshot.sma_20;
+            sma_50[i] = snapshot.sma_50;
+            bb_lower[i] = snapshot.bb_lower;
+        }
+    }
+    
+    StreamingIndicators stream;
+};
+
+class TechnicalIndicators {
+public:
+    static vector<double> calculateSMA(Span<double> prices, int period) {
+        vector<double> sma(prices.size(), 0.0);
+        if (prices.size() < (size_t)period) return sma;
+        
+        RollingStats window(period);
+        for (size_t i = 0; i < prices.size(); ++i) {
+            window.push(prices[i]);
+            if (window.ready()) {
+                sma[i] = window.mean();
+            }
+        }
+        return sma;
+    }
+    static vector<double> calculateEMA(Span<double> prices, int period) {
+        vector<double> ema(prices.size(), 0.0);
+        if (prices.empty()) return ema;
+        
+        double multiplier = 2.0 / (period + 1);
+        ema[0] = prices[0];
+        
+        for (size_t i = 1; i < prices.size(); ++i) {
+            ema[i] = (prices[i] * multiplier) + (ema[i - 1] * (1 - multiplier));
+        }
+        
+        return ema;
+    }
+    
+    static vector<double> calculateRSI(Span<double> prices, int period = 14) {
+        vector<double> rsi(prices.size(), 50.0);
+        if (prices.size() <= (size_t)period) return rsi;
+        
+        vector<double> gains, losses;
+        for (size_t i = 1; i < prices.size(); ++i) {
+            double change = prices[i] - prices[i - 1];
+            gains.push_back(change > 0 ? change : 0);
+            losses.push_back(change < 0 ? -change : 0);
+        }
+        
+        double avg_gain = 0.0, avg_loss = 0.0;
+        for (int i = 0; i < period; ++i) {
+            avg_gain += gains[i];
+            avg_loss += losses[i];
+        }
+        avg_gain /= period;
+        avg_loss /= period;
+        
+        for (size_t i = period; i < prices.size(); ++i) {
+            if (i - 1 < gains.size()) {
+                avg_gain = (avg_gain * (period - 1) + gains[i - 1]) / period;
+                avg_loss = (avg_loss * (period - 1) + losses[i - 1]) / period;
+                
+                if (avg_loss == 0) {
+                    rsi[i] = 100.0;
+                } else {
+                    rsi[i] = 100.0 - (100.0 / (1.0 + (avg_gain / avg_loss)));
+                }
+            }
+        }
+        
+        return rsi;
+    }
+    
+    static MACDResult calculateMACD(Span<double> prices, int fast_period = 12, int slow_period = 26, int signal_period = 9) {
+        
+        vector<double> ema_fast = calculateEMA(prices, fast_period);
+        vector<double> ema_slow = calculateEMA(prices, slow_period);
+        vector<double> macd(prices.size(), 0.0);
+        
+        for (size_t i = 0; i < prices.size(); ++i) {
+            macd[i] = ema_fast[i] - ema_slow[i];
+        }
+        
+        vector<double> signal = calculateEMA(macd, signal_period);
+        vector<double> histogram(prices.size());
+        
+        for (size_t i = 0; i < prices.size(); ++i) {
+            histogram[i] = macd[i] - signal[i];
+        }
+        
+        MACDResult result;
+        result.macd = macd;
+        result.signal = signal;
+        result.histogram = histogram;
+        
+        return result;
+    }
+    
+    // Middle/upper/lower bands and the rolling stddev in a single O(n) pass.
+    static BollingerResult calculateBollingerBandsFull(Span<double> prices, int period = 20, double std_dev = 2.0) {
+        BollingerResult result;
+        result.middle.assign(prices.size(), 0.0);
+        result.upper.assign(prices.size(), 0.0);
+        result.lower.assign(prices.size(), 0.0);
+        result.stddev.assign(prices.size(), 0.0);
+        if (period <= 0) return result;
+        
+        RollingStats window(period);
+        for (size_t i = 0; i < prices.size(); ++i) {
+            window.push(prices[i]);
+            if (!window.ready()) continue;
+            
+            double sma = window.mean();
+            double std = window.stddev();
+            result.middle[i] = sma;
+            result.upper[i] = sma + (std * std_dev);
+            result.lower[i] = sma - (std * std_dev);
+            result.stddev[i] = std;
+        }
+        
+        return result;
+    }
+    
+    static vector<double> calculateBollingerBands(Span<double> prices, int period = 20, double std_dev = 2.0) {
+        return calculateBollingerBandsFull(prices, period, std_dev).lower;
+    }
+    
+    // Original O(n * period) SMA, re-summing every window. Kept as the
+    // reference the rolling kernels are checked against (--check-rolling).
+    static vector<double> calculateSMAReference(Span<double> prices, int period) {
+        vector<double> sma(prices.size(), 0.0);
+        if (period <= 0 || prices.size() < (size_t)period) return sma;
+        
+        for (size_t i = period - 1; i < prices.size(); ++i) {
+            double sum = 0.0;
+            for (int j = 0; j < period; ++j) {
+                sum += prices[i - j];
+            }
+            sma[i] = sum / period;
+        }
+        return sma;
+    }
+    
+    // Original two-pass Bollinger Bands over every window (reference for
+    // calculateBollingerBandsFull).
+    static BollingerResult calculateBollingerBandsReference(Span<double> prices, int period = 20, double std_dev = 2.0) {
+        BollingerResult result;
+        result.middle.assign(prices.size(), 0.0);
+        result.upper.assign(prices.size(), 0.0);
+        result.lower.assign(prices.size(), 0.0);
+        result.stddev.assign(prices.size(), 0.0);
+        if (period <= 0 || prices.size() < (size_t)period) return result;
+        
+        for (size_t i = period - 1; i < prices.size(); ++i) {
+            double sum = 0.0;
+            for (int j = 0; j < period; ++j) {
+                sum += prices[i - j];
+            }
+            double sma = sum / period;
+            
+            double variance = 0.0;
+            for (int j = 0; j < period; ++j) {
+                variance += pow(prices[i - j] - sma, 2);
+            }
+            double std = sqrt(variance / period);
+            
+            result.middle[i] = sma;
+            result.upper[i] = sma + (std * std_dev);
+            result.lower[i] = sma - (std * std_dev);
+            result.stddev[i] = std;
+        }
+        return result;
+    }
+    
+    static IndicatorSet calculateStrategyIndicators(const vector<PriceData>& price_data) {
+        IndicatorSet indicators;
+        IndicatorEngine().compute(price_data, indicators);
+        return indicators;
+    }
+    
+    static IndicatorSet calculateStrategyIndicators(const PriceView& bars) {
+        IndicatorSet indicators;
+        IndicatorEngine().compute(bars, indicators);
+        return indicators;
+    }
+};
+
+// Many symbols' series of equal length stored bar-major and interleaved:
+// value(bar, symbol) = data[bar * stride + symbol]. The stride is padded to
+// a multiple of LANES so the batched kernels can step whole blocks of symbols.
+struct InterleavedSeries {
+    static const size_t LANES = 8;
+    
+    size_t symbols = 0;
+    size_t bars = 0;
+    size_t stride = 0;
+    vector<double> data;
+    
+    void resize(size_t symbol_count, size_t bar_count) {
+        symbols = symbol_count;
+        bars = bar_count;
+        stride = (symbol_count + LANES - 1) / LANES * LANES;
+        data.assign(stride * bars, 0.0);
+    }
+    
+    double at(size_t bar, size_t symbol) const { return data[bar * stride + symbol]; }
+    double* row(size_t bar) { return data.data() + bar * stride; }
+    const double* row(size_t bar) const { return data.data() + bar * stride; }
+    
+    // Packs equally long series; padding lanes repeat the first symbol so
+    // they stay numerically well-behaved.
+    static InterleavedSeries pack(const vector<Span<double>>& series) {
+        InterleavedSeries packed;
+        if (series.empty()) return packed;
+        size_t bar_count = series[0].size();
+        for (const auto& s : series) {
+            if (s.size() != bar_count) {
+                throw runtime_error("Interleaved series must all have the same length");
+            }
+        }
+        
+        packed.resize(series.size(), bar_count);
+        for (size_t t = 0; t < bar_count; ++t) {
+            double* out = packed.row(t);
+            for (size_t s = 0; s < packed.stride; ++s) {
+                out[s] = series[s < series.size() ? s : 0][t];
+            }
+        }
+        return packed;
+    }
+    
+    vector<double> unpack(size_t symbol) const {
+        vector<double> values(bars);
+        for (size_t t = 0; t < bars; ++t) values[t] = at(t, symbol);
+        return values;
+    }
+};
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FINSIMX_X86_DISPATCH 1
+#else
+#define FINSIMX_X86_DISPATCH 0
+#endif
+
+// Block helpers take blocks by reference and write results through an out
+// parameter. GCC warns (-Wpsabi) about any function that returns a block
+// wider than the target's vector registers, even one that is always inlined,
+// and reports it at the end of the file, where no pragma can scope it.
+#if defined(__GNUC__)
+#define FINSIMX_ALWAYS_INLINE inline __attribute__((always_inline))
+// One block of InterleavedSeries::LANES doubles. The compiler lowers block
+// arithmetic to whatever vector width the enclosing function targets.
+typedef double LaneBlock __attribute__((vector_size(InterleavedSeries::LANES * sizeof(double))));
+// The same block at any double-aligned address, e.g. inside a row
+typedef double LaneSlot __attribute__((vector_size(InterleavedSeries::LANES * sizeof(double)),
+                                       aligned(sizeof(double)), may_alias));
+
+static FINSIMX_ALWAYS_INLINE const LaneSlot& laneLoad(const double* p) {
+    return *reinterpret_cast<const LaneSlot*>(p);
+}
+static FINSIMX_ALWAYS_INLINE void laneSelect(LaneBlock& out, const LaneBlock& a, const LaneBlock& b,
+                                             const LaneBlock& if_equal, const LaneBlock& otherwise) {
+    out = a == b ? if_equal : otherwise;
+}
+static FINSIMX_ALWAYS_INLINE void laneMax(LaneBlock& out, const LaneBlock& a, const LaneBlock& b) {
+    out = a > b ? a : b;
+}
+#else
+#define FINSIMX_ALWAYS_INLINE inline
+// Portable stand-in for compilers without vector extensions.
+struct LaneBlock {
+    double v[InterleavedSeries::LANES];
+    double& operator[](size_t i) { return v[i]; }
+    double operator[](size_t i) const { return v[i]; }
+};
+
+#define FINSIMX_LANE_OP(OP)                                                          \
+    static inline LaneBlock operator OP(LaneBlock a, LaneBlock b) {                  \
+        for (size_t l = 0; l < InterleavedSeries::LANES; ++l) a.v[l] = a.v[l] OP b.v[l]; \
+        return a;                                                                    \
+    }
+FINSIMX_LANE_OP(+)
+FINSIMX_LANE_OP(-)
+FINSIMX_LANE_OP(*)
+FINSIMX_LANE_OP(/)
+#undef FINSIMX_LANE_OP
+
+static inline LaneBlock laneLoad(const double* p) {
+    LaneBlock v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+static inline void laneSelect(LaneBlock& out, const LaneBlock& a, const LaneBlock& b,
+                              const LaneBlock& if_equal, const LaneBlock& otherwise) {
+    for (size_t l = 0; l < InterleavedSeries::LANES; ++l) {
+        out.v[l] = a.v[l] == b.v[l] ? if_equal.v[l] : otherwise.v[l];
+    }
+}
+static inline void laneMax(LaneBlock& out, const LaneBlock& a, const LaneBlock& b) {
+    for (size_t l = 0; l < InterleavedSeries::LANES; ++l) out.v[l] = a.v[l] > b.v[l] ? a.v[l] : b.v[l];
+}
+#endif
+
+static FINSIMX_ALWAYS_INLINE void laneStore(double* p, const LaneBlock& v) { memcpy(p, &v, sizeof(v)); }
+static FINSIMX_ALWAYS_INLINE void laneSet(LaneBlock& out, double x) {
+    out = LaneBlock();
+    for (size_t l = 0; l < InterleavedSeries::LANES; ++l) out[l] = x;
+}
+static FINSIMX_ALWAYS_INLINE void laneSqrt(LaneBlock& out, const LaneBlock& x) {
+    for (size_t l = 0; l < InterleavedSeries::LANES; ++l) out[l] = sqrt(x[l]);
+}
+
+// Cross-symbol indicator kernels. Each bar is processed as LaneBlocks of
+// InterleavedSeries::LANES symbols with no cross-lane dependencies, so a
+// block is 2 AVX2 or 1 AVX-512 register when the kernel is instantiated for
+// that target. The per-lane arithmetic mirrors the scalar indicator classes,
+// so results match TechnicalIndicators up to FMA rounding.
+struct LaneKernels {
+    static const size_t L = InterleavedSeries::LANES;
+    
+    static FINSIMX_ALWAYS_INLINE void ema(const InterleavedSeries& in, int period, InterleavedSeries& out) {
+        LaneBlock m, one_minus_m;
+        laneSet(m, 2.0 / (period + 1));
+        laneSet(one_minus_m, 1 - 2.0 / (period + 1));
+        for (size_t t = 0; t < in.bars; ++t) {
+            const double* x = in.row(t);
+            double* y = out.row(t);
+            if (t == 0) {
+                memcpy(y, x, in.stride * sizeof(double));
+                continue;
+            }
+            const double* prev = out.row(t - 1);
+            for (size_t b = 0; b < in.stride; b += L) {
+                laneStore(y + b, (laneLoad(x + b) * m) + (laneLoad(prev + b) * one_minus_m));
+            }
+        }
+    }
+    
+    static FINSIMX_ALWAYS_INLINE void rsi(const InterleavedSeries& in, int period, InterleavedSeries& out,
+                                          double* avg_gain, double* avg_loss) {
+        const size_t p = (size_t)period;
+        LaneBlock zero, hundred, one, n, n_minus_1;
+        laneSet(zero, 0.0);
+        laneSet(hundred, 100.0);
+        laneSet(one, 1.0);
+        laneSet(n, (double)period);
+        laneSet(n_minus_1, (double)(period - 1));
+        fill(avg_gain, avg_gain + in.stride, 0.0);
+        fill(avg_loss, avg_loss + in.stride, 0.0);
+        
+        for (size_t t = 0; t < in.bars; ++t) {
+            double* y = out.row(t);
+            if (t == 0) {
+                fill(y, y + in.stride, 50.0);
+                continue;
+            }
+            const double* x = in.row(t);
+            const double* prev = in.row(t - 1);
+            
+            if (t <= p) {
+                for (size_t b = 0; b < in.stride; b += L) {
+                    LaneBlock change = laneLoad(x + b) - laneLoad(prev + b);
+                    LaneBlock gain, loss;
+                    laneMax(gain, change, zero);
+                    laneMax(loss, zero - change, zero);
+                    laneStore(avg_gain + b, laneLoad(avg_gain + b) + gain);
+                    laneStore(avg_loss + b, laneLoad(avg_loss + b) + loss);
+                }
+                if (t < p) {
+                    fill(y, y + in.stride, 50.0);
+                    continue;
+                }
+                for (size_t b = 0; b < in.stride; b += L) {
+                    laneStore(avg_gain + b, laneLoad(avg_gain + b) / n);
+                    laneStore(avg_loss + b, laneLoad(avg_loss + b) / n);
+                }
+            }
+            
+            // Wilder smoothing; at t == period the seeding change is applied
+            // again, exactly like the scalar implementation
+            for (size_t b = 0; b < in.stride; b += L) {
+                LaneBlock change = laneLoad(x + b) - laneLoad(prev + b);
+                LaneBlock gain, loss;
+                laneMax(gain, change, zero);
+                laneMax(loss, zero - change, zero);
+                LaneBlock g = (laneLoad(avg_gain + b) * n_minus_1 + gain) / n;
+                LaneBlock d = (laneLoad(avg_loss + b) * n_minus_1 + loss) / n;
+                laneStore(avg_gain + b, g);
+                laneStore(avg_loss + b, d);
+                LaneBlock value = hundred - (hundred / (one + (g / d)));
+                laneSelect(value, d, zero, hundred, value);
+                laneStore(y + b, value);
+            }
+        }
+    }
+    
+    static FINSIMX_ALWAYS_INLINE void macd(const InterleavedSeries& in, int fast_period, int slow_period,
+                                           int signal_period, InterleavedSeries& macd_out,
+                                           InterleavedSeries& signal_out, InterleavedSeries& histogram_out,
+                                           double* ema_fast, double* ema_slow) {
+        LaneBlock mf, mf_rest, ms, ms_rest, mg, mg_rest;
+        laneSet(mf, 2.0 / (fast_period + 1));
+        laneSet(mf_rest, 1 - 2.0 / (fast_period + 1));
+        laneSet(ms, 2.0 / (slow_period + 1));
+        laneSet(ms_rest, 1 - 2.0 / (slow_period + 1));
+        laneSet(mg, 2.0 / (signal_period + 1));
+        laneSet(mg_rest, 1 - 2.0 / (signal_period + 1));
+        
+        for (size_t t = 0; t < in.bars; ++t) {
+            const double* x = in.row(t);
+            double* m = macd_out.row(t);
+            double* g = signal_out.row(t);
+            double* h = histogram_out.row(t);
+            if (t == 0) {
+                for (size_t s = 0; s < in.stride; ++s) {
+                    ema_fast[s] = x[s];
+                    ema_slow[s] = x[s];
+                    m[s] = ema_fast[s] - ema_slow[s];
+                    g[s] = m[s];
+                    h[s] = m[s] - g[s];
+                }
+                continue;
+            }
+            const double* prev_signal = signal_out.row(t - 1);
+            for (size_t b = 0; b < in.stride; b += L) {
+                LaneBlock price = laneLoad(x + b);
+                LaneBlock fast = (price * mf) + (laneLoad(ema_fast + b) * mf_rest);
+                LaneBlock slow = (price * ms) + (laneLoad(ema_slow + b) * ms_rest);
+                LaneBlock line = fast - slow;
+                LaneBlock signal = (line * mg) + (laneLoad(prev_signal + b) * mg_rest);
+                laneStore(ema_fast + b, fast);
+                laneStore(ema_slow + b, slow);
+                laneStore(m + b, line);
+                laneStore(g + b, signal);
+                laneStore(h + b, line - signal);
+            }
+        }
+    }
+    
+    // Rolling mean (and, with bands, mean - k * stddev) using the same
+    // sliding Welford update and resync schedule as RollingStats.
+    static FINSIMX_ALWAYS_INLINE void rolling(const InterleavedSeries& in, int period, double k, bool bands,
+                                              InterleavedSeries& out, double* mean, double* m2) {
+        const size_t p = (size_t)period;
+        LaneBlock zero, n, width;
+        laneSet(zero, 0.0);
+        laneSet(n, (double)period);
+        laneSet(width, k);
+        fill(mean, mean + in.stride, 0.0);
+        fill(m2, m2 + in.stride, 0.0);
+        
+        for (size_t t = 0; t < in.bars; ++t) {
+            const double* x = in.row(t);
+            double* y = out.row(t);
+            
+            if (t < p) {
+                LaneBlock count;
+                laneSet(count, (double)(t + 1));
+                for (size_t b = 0; b < in.stride; b += L) {
+                    LaneBlock price = laneLoad(x + b);
+                    LaneBlock delta = price - laneLoad(mean + b);
+                    LaneBlock updated = laneLoad(mean + b) + delta / count;
+                    laneStore(mean + b, updated);
+                    laneStore(m2 + b, laneLoad(m2 + b) + delta * (price - updated));
+                }
+            } else if ((t - p + 1) % RollingStats::RESYNC_INTERVAL == 0) {
+                for (size_t s = 0; s < in.stride; ++s) {
+                    double sum = 0.0;
+                    for (size_t j = t + 1 - p; j <= t; ++j) sum += in.row(j)[s];
+                    double mu = sum / period;
+                    double acc = 0.0;
+                    for (size_t j = t + 1 - p; j <= t; ++j) acc += (in.row(j)[s] - mu) * (in.row(j)[s] - mu);
+                    mean[s] = mu;
+                    m2[s] = acc;
+                }
+            } else {
+                const double* old = in.row(t - p);
+                for (size_t b = 0; b < in.stride; b += L) {
+                    LaneBlock price = laneLoad(x + b);
+                    LaneBlock expired = laneLoad(old + b);
+                    LaneBlock diff = price - expired;
+                    LaneBlock old_mean = laneLoad(mean + b);
+                    LaneBlock updated = old_mean + diff / n;
+                    LaneBlock acc = laneLoad(m2 + b) + diff * ((price - updated) + (expired - old_mean));
+                    laneMax(acc, acc, zero);
+                    laneStore(mean + b, updated);
+                    laneStore(m2 + b, acc);
+                }
+            }
+            
+            if (t + 1 < p) {
+                fill(y, y + in.stride, 0.0);
+            } else if (bands) {
+                for (size_t b = 0; b < in.stride; b += L) {
+                    LaneBlock deviation;
+                    laneSqrt(deviation, laneLoad(m2 + b) / n);
+                    laneStore(y + b, laneLoad(mean + b) - (deviation * width));
+                }
+            } else {
+                memcpy(y, mean, in.stride * sizeof(double));
+            }
+        }
+    }
+};
+
+enum class SimdLevel { Scalar, AVX2, AVX512 };
+
+// Per-ISA instantiations of LaneKernels. The Scalar set is compiled for the
+// baseline target and is always available.
+#define FINSIMX_KERNEL_SET(NAME, ATTR)                                                              \
+    struct NAME {                                                                                   \
+        ATTR static void ema(const InterleavedSeries& in, int period, InterleavedSeries& out) {     \
+            LaneKernels::ema(in, period, out);                                                      \
+        }                                                                                           \
+        ATTR static void rsi(const InterleavedSeries& in, int period, InterleavedSeries& out,       \
+                             double* avg_gain, double* avg_loss) {                                  \
+            LaneKernels::rsi(in, period, out, avg_gain, avg_loss);                                  \
+        }                                                                                           \
+        ATTR static void macd(const InterleavedSeries& in, int fast, int slow, int signal,          \
+                              InterleavedSeries& m, InterleavedSeries& g, InterleavedSeries& h,     \
+                              double* ema_fast, double* ema_slow) {                                 \
+            LaneKernels::macd(in, fast, slow, signal, m, g, h, ema_fast, ema_slow);                 \
+        }                                                                                           \
+        ATTR static void rolling(const InterleavedSeries& in, int period, double k, bool bands,     \
+                                 InterleavedSeries& out, double* mean, double* m2) {                \
+            LaneKernels::rolling(in, period, k, bands, out, mean, m2);                              \
+        }                                                                                           \
+    };
+
+FINSIMX_KERNEL_SET(ScalarKernels, )
+#if FINSIMX_X86_DISPATCH
+FINSIMX_KERNEL_SET(AVX2Kernels, __attribute__((target("avx2,fma"))))
+FINSIMX_KERNEL_SET(AVX512Kernels, __attribute__((target("avx512f"))))
+#endif
+#undef FINSIMX_KERNEL_SET
+
+// Batched SMA / EMA / RSI / MACD / Bollinger lower band over an
+// InterleavedSeries, dispatched at runtime to the widest supported ISA.
+class BatchIndicators {
+public:
+    static SimdLevel detectLevel() {
+#if FINSIMX_X86_DISPATCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdLevel::AVX2;
+#endif
+        return SimdLevel::Scalar;
+    }
+    
+    static SimdLevel level() { return activeLevel(); }
+    
+    // Forces a kernel set (clamped to what the CPU supports), e.g. to
+    // compare against the scalar fallback.
+    static void setLevel(SimdLevel requested) {
+        activeLevel() = min(requested, detectLevel());
+    }
+    
+    static const char* levelName(SimdLevel level) {
+        switch (level) {
+            case SimdLevel::AVX512: return "AVX-512";
+            case SimdLevel::AVX2: return "AVX2";
+            default: return "scalar";
+        }
+    }
+    
+    static void sma(const InterleavedSeries& close, int period, InterleavedSeries& out) {
+        prepare(close, out);
+        vector<double> mean(close.stride), m2(close.stride);
+        dispatch([&](auto kernels) { kernels.rolling(close, period, 0.0, false, out, mean.data(), m2.data()); });
+    }
+    
+    static void ema(const InterleavedSeries& close, int period, InterleavedSeries& out) {
+        prepare(close, out);
+        dispatch([&](auto kernels) { kernels.ema(close, period, out); });
+    }
+    
+    static void rsi(const InterleavedSeries& close, int period, InterleavedSeries& out) {
+        prepare(close, out);
+        vector<double> avg_gain(close.stride), avg_loss(close.stride);
+        dispatch([&](auto kernels) { kernels.rsi(close, period, out, avg_gain.data(), avg_loss.data()); });
+    }
+    
+    static void macd(const InterleavedSeries& close, InterleavedSeries& macd_out, InterleavedSeries& signal_out,
+                     InterleavedSeries& histogram_out, int fast_period = 12, int slow_period = 26,
+                     int signal_period = 9) {
+        prepare(close, macd_out);
+        prepare(close, signal_out);
+        prepare(close, histogram_out);
+        vector<double> ema_fast(close.stride), ema_slow(close.stride);
+        dispatch([&](auto kernels) {
+            kernels.macd(close, fast_period, slow_period, signal_period, macd_out, signal_out, histogram_out,
+                         ema_fast.data(), ema_slow.data());
+        });
+    }
+    
+    static void bollingerLower(const InterleavedSeries& close, int period, double std_dev, InterleavedSeries& out) {
+        prepare(close, out);
+        vector<double> mean(close.stride), m2(close.stride);
+        dispatch([&](auto kernels) { kernels.rolling(close, period, std_dev, true, out, mean.data(), m2.data()); });
+    }
+    
+private:
+    static SimdLevel& activeLevel() {
+        static SimdLevel level = detectLevel();
+        return level;
+    }
+    
+    static void prepare(const InterleavedSeries& in, InterleavedSeries& out) {
+        if (out.symbols != in.symbols || out.bars != in.bars || out.stride != in.stride) {
+            out.resize(in.symbols, in.bars);
+        }
+    }
+    
+    template <typename Fn>
+    static void dispatch(Fn fn) {
+#if FINSIMX_X86_DISPATCH
+        switch (activeLevel()) {
+            case SimdLevel::AVX512: fn(AVX512Kernels()); return;
+            case SimdLevel::AVX2: fn(AVX2Kernels()); return;
+            default: break;
+        }
+#endif
+        fn(ScalarKernels());
+    }
+};
+
+class CSVParser {
+public:
+    static vector<PriceData> loadPriceData(const string& filename) {
+        vector<PriceData> data;
+        ifstream file(filename.c_str());
+        
+        if (!file.is_open()) {
+            throw runtime_error("Cannot open file: " + filename);
+        }
+        
+        string line;
+        bool first_line = true;
+        
+        while (getline(file, line)) {
+            if (first_line) {
+                first_line = false;
+                continue;
+            }
+            
+            if (line.empty()) continue;
+            
+            try {
+                PriceData price_data = parseLine(line);
+                if (price_data.close > 0) {
+                    data.push_back(price_data);
+                }
+            } catch (const exception& e) {
+                cerr << "Error parsing line: " << line << " - " << e.what() << endl;
+            }
+        }
+        
+        if (data.empty()) {
+            throw runtime_error("No valid price data found in file");
+        }
+        
+        return data;
+    }
+    
+private:
+    static PriceData parseLine(const string& line) {
+        PriceData data;
+        stringstream ss(line);
+        string field;
+        int field_count = 0;
+        
+        while (getline(ss, field, ',')) {
+            try {
+                switch (field_count) {
+                    case 0:
+                        Timestamp::parse(field.data(), field.data() + field.size(), data.timestamp);
+                        break;
+                    case 1: data.open = atof(field.c_str()); break;
+                    case 2: data.high = atof(field.c_str()); break;
+                    case 3: data.low = atof(field.c_str()); break;
+                    case 4: data.close = atof(field.c_str()); break;
+                    case 5: data.volume = atof(field.c_str()); break;
+                }
+                field_count++;
+            } catch (const exception& e) {
+                throw runtime_error("Invalid number format in field: " + field);
+            }
+        }
+        
+        if (field_count < 5) {
+            throw runtime_error("Insufficient fields in CSV line");
+        }
+        
+        return data;
+    }
+};
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+    explicit MappedFile(const string& filename) : data_(nullptr), size_(0) {
+#ifdef _WIN32
+        file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw runtime_error("Cannot open file: " + filename);
+        }
+        LARGE_INTEGER file_size;
+        GetFileSizeEx(file, &file_size);
+        size_ = (size_t)file_size.QuadPart;
+        mapping = nullptr;
+        if (size_ > 0) {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping != nullptr) {
+                data_ = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            }
+            if (data_ == nullptr) {
+                if (mapping != nullptr) CloseHandle(mapping);
+                CloseHandle(file);
+                throw runtime_error("Cannot map file: " + filename);
+            }
+        }
+#else
+        fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw runtime_error("Cannot open file: " + filename);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw runtime_error("Cannot stat file: " + filename);
+        }
+        size_ = (size_t)st.st_size;
+        if (size_ > 0) {
+            void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                close(fd);
+                throw runtime_error("Cannot map file: " + filename);
+            }
+            madvise(addr, size_, MADV_SEQUENTIAL);
+            data_ = (const char*)addr;
+        }
+#endif
+    }
+    
+    ~MappedFile() {
+#ifdef _WIN32
+        if (data_ != nullptr) UnmapViewOfFile(data_);
+        if (mapping != nullptr) CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        if (data_ != nullptr) munmap((void*)data_, size_);
+        close(fd);
+#endif
+    }
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    
+private:
+    const char* data_;
+    size_t size_;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+};
+
+// Zero-copy CSV loader: scans a memory-mapped file in place, parses numbers
+// with from_chars and stores dates as integer timestamps.
+//
+// Columns are matched by header name, so plain ("Close") and yfinance
+// tuple-style ("('Close', 'AAPL')") headers both work; when several columns
+// map to the same field the first non-empty one wins. Rows without a valid
+// date or a positive close (e.g. the ",AAPL,AAPL,..." ticker row) are skipped.
+// Missing open/high/low fall back to the close and missing volume to 0.
+class FastCSVParser {
+public:
+    static PriceSeries loadPriceSeries(const string& filename) {
+        Profiler::Scope scope("csv load");
+        MappedFile file(filename);
+        PriceSeries series = parse(file.data(), file.size());
+        scope.setBars(series.size());
+        if (series.symbol.empty()) {
+            series.symbol = std::filesystem::path(filename).stem().string();
+        }
+        if (series.size() == 0) {
+            throw runtime_error("No valid price data found in file");
+        }
+        return series;
+    }
+    
+    static vector<PriceData> loadPriceData(const string& filename) {
+        return loadPriceSeries(filename).toPriceData();
+    }
+    
+    static PriceSeries parse(const char* data, size_t size) {
+        PriceSeries series;
+        vector<int> roles;
+        const char* end = data + size;
+        const char* p = data + parseHeader(data, size, roles, series.symbol);
+        
+        // Size the columns from the average length of the first rows
+        const char* sample_end = p;
+        for (int i = 0; i < 16 && sample_end < end; ++i) {
+            const char* next = findLineEnd(sample_end, end);
+            sample_end = next < end ? next + 1 : end;
+        }
+        if (sample_end > p) {
+            series.reserve((size_t)((double)(end - p) / (sample_end - p) * 16) + 16);
+        }
+        
+        parseRows(p, end, roles, series);
+        return series;
+    }
+    
+    // Maps every header column to the price field it feeds (see parseRows)
+    // and returns the offset of the first data row. symbol is set from a
+    // tuple-style header, if there is one.
+    static size_t parseHeader(const char* data, size_t size, vector<int>& roles, string& symbol) {
+        const char* p = data;
+        const char* end = data + size;
+        if (size >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0) p += 3;  // UTF-8 BOM
+        
+        const char* line_end = findLineEnd(p, end);
+        vector<FieldRef> header;
+        splitLine(p, trimCR(p, line_end), header);
+        roles.clear();
+        for (const auto& field : header) {
+            string name = columnName(field);
+            roles.push_back(fieldRole(name));
+            if (symbol.empty()) symbol = tupleTicker(field);
+        }
+        if (find(roles.begin(), roles.end(), (int)CLOSE) == roles.end()) {
+            throw runtime_error("CSV header has no Close column");
+        }
+        if (find(roles.begin(), roles.end(), (int)DATE) == roles.end() && !roles.empty()) {
+            roles[0] = DATE;  // yfinance "Price" / unnamed index column
+        }
+        return (size_t)((line_end < end ? line_end + 1 : end) - data);
+    }
+    
+    // Appends the rows in [p, end) to series, using the roles of parseHeader.
+    static void parseRows(const char* p, const char* end, const vector<int>& roles, PriceSeries& series) {
+        vector<FieldRef> fields;
+        fields.reserve(roles.size());
+        while (p < end) {
+            const char* line_end = findLineEnd(p, end);
+            const char* row_end = trimCR(p, line_end);
+            const char* next = line_end < end ? line_end + 1 : end;
+            if (row_end == p) {
+                p = next;
+                continue;
+            }
+            
+            FieldRef picked[FIELD_COUNT] = {};
+            splitLine(p, row_end, fields);
+            for (size_t c = 0; c < fields.size() && c < roles.size(); ++c) {
+                int role = roles[c];
+                if (role != NONE && picked[role].begin == nullptr && fields[c].end > fields[c].begin) {
+                    picked[role] = fields[c];
+                }
+            }
+            p = next;
+            
+            int64_t timestamp;
+            double values[FIELD_COUNT] = {};
+            if (picked[DATE].begin == nullptr ||
+                !Timestamp::parse(picked[DATE].begin, picked[DATE].end, timestamp) ||
+                !parseDouble(picked[CLOSE], values[CLOSE]) || values[CLOSE] <= 0) {
+                // yfinance writes the ticker as a second header row
+                if (series.size() == 0 && series.symbol.empty() &&
+                    picked[DATE].begin == nullptr && picked[CLOSE].begin != nullptr) {
+                    series.symbol.assign(picked[CLOSE].begin, picked[CLOSE].end);
+                }
+                series.skipped_rows++;
+                continue;
+            }
+            for (int role = OPEN; role <= LOW; ++role) {
+                if (!parseDouble(picked[role], values[role])) values[role] = values[CLOSE];
+            }
+            if (!parseDouble(picked[VOLUME], values[VOLUME])) values[VOLUME] = 0.0;
+            
+            series.timestamp.push_back(timestamp);
+            series.open.push_back(values[OPEN]);
+            series.high.push_back(values[HIGH]);
+            series.low.push_back(values[LOW]);
+            series.close.push_back(values[CLOSE]);
+            series.volume.push_back(values[VOLUME]);
+        }
+    }
+    
+private:
+    enum Field { NONE = -1, DATE = 0, OPEN, HIGH, LOW, CLOSE, VOLUME, FIELD_COUNT };
+    
+    struct FieldRef {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+    };
+    
+    static const char* findLineEnd(const char* p, const char* end) {
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        return nl != nullptr ? nl : end;
+    }
+    
+    static const char* trimCR(const char* begin, const char* end) {
+        return (end > begin && end[-1] == '\r') ? end - 1 : end;
+    }
+    
+    // Splits [p, end) on commas into fields, honouring double quotes.
+    static void splitLine(const char* p, const char* end, vector<FieldRef>& fields) {
+        fields.clear();
+        while (true) {
+            FieldRef field;
+            if (p < end && *p == '"') {
+                const char* close_quote = (const char*)memchr(p + 1, '"', end - p - 1);
+                field.begin = p + 1;
+                field.end = close_quote != nullptr ? close_quote : end;
+                p = close_quote != nullptr ? close_quote + 1 : end;
+                const char* comma = (const char*)memchr(p, ',', end - p);
+                p = comma != nullptr ? comma : end;
+            } else {
+                const char* comma = (const char*)memchr(p, ',', end - p);
+                field.begin = p;
+                field.end = comma != nullptr ? comma : end;
+                p = field.end;
+            }
+            fields.push_back(field);
+            if (p >= end) break;
+            ++p;
+        }
+    }
+    
+    static bool parseDouble(const FieldRef& field, double& value) {
+        const char* begin = field.begin;
+        if (begin == nullptr) return false;
+        if (begin < field.end && *begin == '+') ++begin;
+        auto result = from_chars(begin, field.end, value);
+        return result.ec == errc() && result.ptr == field.end;
+    }
+    
+    // "('Close', 'AAPL')" -> "close", "Adj Close" -> "adj close"
+    static string columnName(const FieldRef& field) {
+        string name(field.begin, field.end);
+        if (!name.empty() && name[0] == '(') {
+            size_t open_quote = name.find('\'');
+            size_t close_quote = open_quote == string::npos ? string::npos : name.find('\'', open_quote + 1);
+            if (close_quote != string::npos) {
+                name = name.substr(open_quote + 1, close_quote - open_quote - 1);
+            }
+        }
+        for (char& c : name) c = (char)tolower((unsigned char)c);
+        return name;
+    }
+    
+    // "('Close', 'AAPL')" -> "AAPL"
+    static string tupleTicker(const FieldRef& field) {
+        string name(field.begin, field.end);
+        if (name.empty() || name[0] != '(') return "";
+        size_t comma = name.find(',');
+        if (comma == string::npos) return "";
+        size_t open_quote = name.find('\'', comma);
+        size_t close_quote = open_quote == string::npos ? string::npos : name.find('\'', open_quote + 1);
+        if (close_quote == string::npos) return "";
+        return name.substr(open_quote + 1, close_quote - open_quote - 1);
+    }
+    
+    static int fieldRole(const string& name) {
+        if (name == "date" || name == "datetime" || name == "timestamp") return DATE;
+        if (name == "open") return OPEN;
+        if (name == "high") return HIGH;
+        if (name == "low") return LOW;
+        if (name == "close") return CLOSE;
+        if (name == "volume") return VOLUME;
+        return NONE;
+    }
+};
+
+vector<PriceData> PriceView::toPriceData() const {
+    vector<PriceData> data(size());
+    for (size_t i = 0; i < size(); ++i) {
+        data[i].timestamp = timestamp[i];
+        data[i].open = open[i];
+        data[i].high = high[i];
+        data[i].low = low[i];
+        data[i].close = close[i];
+        data[i].volume = volume[i];
+    }
+    return data;
+}
+
+// Columnar binary price store. Layout (native little-endian):
+//   64-byte BinaryPriceHeader
+//   int64  timestamp[rows]   (seconds since epoch, see Timestamp)
+//   double open[rows], high[rows], low[rows], close[rows], volume[rows]
+// Opening a file only maps it; the columns are exposed in place as Spans.
+struct BinaryPriceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t rows;
+    char symbol[40];
+};
+static_assert(sizeof(BinaryPriceHeader) == 64, "BinaryPriceHeader must stay 64 bytes");
+
+class BinaryPriceFile {
+public:
+    static constexpr const char* MAGIC = "FSXBARS";
+    static const uint32_t VERSION = 1;
+    static const size_t COLUMN_COUNT = 6;
+    
+    explicit BinaryPriceFile(const string& filename) : file(filename) {
+        if (file.size() < sizeof(BinaryPriceHeader)) {
+            throw runtime_error("Not a binary price file: " + filename);
+        }
+        BinaryPriceHeader header;
+        memcpy(&header, file.data(), sizeof(header));
+        if (memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0) {
+            throw runtime_error("Not a binary price file: " + filename);
+        }
+        if (header.version != VERSION || header.header_size != sizeof(BinaryPriceHeader)) {
+            throw runtime_error("Unsupported binary price file version: " + filename);
+        }
+        size_t rows = (size_t)header.rows;
+        if ((file.size() - sizeof(header)) / (COLUMN_COUNT * 8) < rows) {
+            throw runtime_error("Truncated binary price file: " + filename);
+        }
+        
+        const char* columns = file.data() + header.header_size;
+        view_.symbol.assign(header.symbol, strnlen(header.symbol, sizeof(header.symbol)));
+        view_.timestamp = Span<int64_t>((const int64_t*)columns, rows);
+        view_.open = Span<double>((const double*)(columns + 1 * rows * 8), rows);
+        view_.high = Span<double>((const double*)(columns + 2 * rows * 8), rows);
+        view_.low = Span<double>((const double*)(columns + 3 * rows * 8), rows);
+        view_.close = Span<double>((const double*)(columns + 4 * rows * 8), rows);
+        view_.volume = Span<double>((const double*)(columns + 5 * rows * 8), rows);
+    }
+    
+    const PriceView& view() const { return view_; }
+    
+    static void write(const PriceView& prices, const string& filename) {
+        ofstream out(filename.c_str(), ios::binary | ios::trunc);
+        if (!out.is_open()) {
+            throw runtime_error("Cannot open output file: " + filename);
+        }
+        
+        BinaryPriceHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, MAGIC, sizeof(header.magic));
+        header.version = VERSION;
+        header.header_size = sizeof(BinaryPriceHeader);
+        header.rows = prices.size();
+        strncpy(header.symbol, prices.symbol.c_str(), sizeof(header.symbol) - 1);
+        
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)prices.timestamp.data(), prices.size() * sizeof(int64_t));
+        for (Span<double> column : {prices.open, prices.high, prices.low, prices.close, prices.volume}) {
+            out.write((const char*)column.data(), column.size() * sizeof(double));
+        }
+        if (!out) {
+            throw runtime_error("Failed writing binary price file: " + filename);
+        }
+    }
+    
+    static bool isBinaryPath(const string& filename) {
+        return std::filesystem::path(filename).extension() == ".fsx";
+    }
+    
+private:
+    MappedFile file;
+    PriceView view_;
+};
+
+// Loads either a CSV or a .fsx binary price file.
+class PriceLoader {
+public:
+    static vector<PriceData> loadPriceData(const string& filename) {
+        if (BinaryPriceFile::isBinaryPath(filename)) {
+            Profiler::Scope scope("fsx load");
+            BinaryPriceFile file(filename);
+            scope.setBars(file.view().size());
+            if (file.view().size() == 0) {
+                throw runtime_error("No valid price data found in file");
+            }
+            return file.view().toPriceData();
+        }
+        return FastCSVParser::loadPriceData(filename);
+    }
+};
+
+// One symbol's columns, parsed from CSV into a PriceSeries or memory-mapped
+// from an .fsx file. view() stays valid for the lifetime of the source.
+class PriceSource {
+public:
+    explicit PriceSource(const string& filename) {
+        if (BinaryPriceFile::isBinaryPath(filename)) {
+            Profiler::Scope scope("fsx load");
+            mapped.reset(new BinaryPriceFile(filename));
+            view_ = mapped->view();
+            scope.setBars(view_.size());
+            if (view_.size() == 0) {
+                throw runtime_error("No valid price data found in file");
+            }
+        } else {
+            series = FastCSVParser::loadPriceSeries(filename);
+            view_ = series.view();
+        }
+    }
+    
+    PriceSource(const PriceSource&) = delete;
+    PriceSource& operator=(const PriceSource&) = delete;
+    
+    const PriceView& view() const { return view_; }
+    void setSymbol(const string& symbol) { view_.symbol = symbol; }
+    
+private:
+    unique_ptr<BinaryPriceFile> mapped;
+    PriceSeries series;
+    PriceView view_;
+};
+
+// 64-bit streaming hash of a byte sequence, one 8-byte word per step. Splitting
+// the input across update() calls gives the same digest as a single call.
+class ContentHash {
+public:
+    ContentHash() : state(0x243F6A8885A308D3ULL), total(0), pending_size(0) {}
+    
+    void update(const char* data, size_t size) {
+        total += size;
+        if (pending_size > 0) {
+            size_t take = min(size, (size_t)8 - pending_size);
+            memcpy(pending + pending_size, data, take);
+            pending_size += take;
+            data += take;
+            size -= take;
+            if (pending_size < 8) return;
+            mixWord(pending);
+            pending_size = 0;
+        }
+        for (; size >= 8; data += 8, size -= 8) {
+            mixWord(data);
+        }
+        memcpy(pending, data, size);
+        pending_size = size;
+    }
+    
+    uint64_t digest() const {
+        ContentHash last = *this;
+        if (last.pending_size > 0) {
+            memset(last.pending + last.pending_size, 0, 8 - last.pending_size);
+            last.mixWord(last.pending);
+        }
+        uint64_t h = last.state ^ total;
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+    
+    static uint64_t of(const char* data, size_t size) {
+        ContentHash hash;
+        hash.update(data, size);
+        return hash.digest();
+    }
+    
+private:
+    void mixWord(const char* p) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        state = (state ^ word) * 0x9E3779B97F4A7C15ULL;
+        state ^= state >> 29;
+    }
+    
+    uint64_t state;
+    uint64_t total;
+    char pending[8];
+    size_t pending_size;
+};
+
+// Indicator checkpoint file layout (native little-endian):
+//   96-byte IndicatorCacheHeader
+//   Series symbol (symbol_bytes, not NUL-terminated)
+//   StreamingIndicators state after the last cached bar (state_bytes)
+//   CachedBar rows[rows]
+// Rows are only ever appended, so an update writes the new rows, the state
+// and the header in place instead of rewriting the file.
+struct IndicatorCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t indicator_key;    // ContentHash of StreamingIndicators::signature()
+    uint64_t data_bytes;       // Length of the source file prefix the rows cover
+    uint64_t data_hash;        // ContentHash of that prefix
+    uint64_t rows;
+    uint64_t state_bytes;
+    uint64_t state_hash;       // Detects a state torn by an interrupted update
+    uint64_t symbol_bytes;
+    uint64_t entry_hash;       // ContentHash of the full cache entry symbol
+    char reserved[16];
+};
+static_assert(sizeof(IndicatorCacheHeader) == 96, "IndicatorCacheHeader must stay 96 bytes");
+
+// One cached bar: its prices and every strategy indicator (close included).
+struct CachedBar {
+    int64_t timestamp;
+    double open, high, low, volume;
+    IndicatorSnapshot indicators;
+};
+static_assert(sizeof(CachedBar) == 112, "CachedBar must stay 112 bytes");
+
+struct CachedPrices {
+    PriceSeries series;
+    IndicatorSet indicators;
+    size_t cached_rows = 0;    // Restored from the checkpoint
+    size_t parsed_rows = 0;    // Parsed from the CSV file in this run
+    bool rebuilt = false;      // No usable checkpoint; parsed from the first row
+};
+
+// On-disk cache of a CSV file's parsed bars and strategy indicators, one file
+// per symbol and indicator signature. A checkpoint is reused while the CSV
+// file still starts with exactly the bytes it was built from (compared by
+// ContentHash); rows appended since are the only ones parsed, and their
+// indicators continue from the saved StreamingIndicators state, so the
+// result is bit-identical to a full IndicatorEngine pass. Any other change to
+// the file rebuilds the checkpoint.
+//
+// A trailing row without a newline is parsed but not checkpointed, since a
+// later append may still extend it.
+class IndicatorCache {
+public:
+    static constexpr const char* MAGIC = "FSXCACHE";
+    static const uint32_t VERSION = 2;
+    
+    static uint64_t indicatorKey() {
+        const char* signature = StreamingIndicators::signature();
+        return ContentHash::of(signature, strlen(signature));
+    }
+    
+    static uint64_t entryHash(const string& symbol) {
+        return ContentHash::of(symbol.data(), symbol.size());
+    }
+    
+    // <directory>/<symbol hash>.<indicator key>.fsxc; hashing the full symbol
+    // gives any symbol, however long, its own valid file name.
+    static string entryPath(const string& directory, const string& symbol) {
+        char name[40];
+        snprintf(name, sizeof(name), "%016llx.%016llx.fsxc", (unsigned long long)entryHash(symbol),
+                 (unsigned long long)indicatorKey());
+        return (std::filesystem::path(directory) / name).string();
+    }
+    
+    // symbol names the cache entry; it defaults to the file name stem.
+    static CachedPrices load(const string& filename, const string& directory, const string& symbol = "") {
+        Profiler::Scope scope("cache load");
+        MappedFile file(filename);
+        const char* data = file.data();
+        size_t size = file.size();
+        string entry_symbol = symbol.empty() ? std::filesystem::path(filename).stem().string() : symbol;
+        string entry = entryPath(directory, entry_symbol);
+        
+        CachedPrices result;
+        vector<int> roles;
+        size_t body = FastCSVParser::parseHeader(data, size, roles, result.series.symbol);
+        
+        StreamingIndicators stream;
+        ContentHash prefix;
+        IndicatorCacheHeader header;
+        ifstream cache;
+        string cached_symbol;
+        result.rebuilt = !openCheckpoint(entry, entryHash(entry_symbol), data, size, body, cache, header,
+                                         cached_symbol, prefix, stream);
+        size_t tail = body;
+        if (result.rebuilt) {
+            stream.reset();
+            prefix = ContentHash();
+        } else {
+            result.cached_rows = (size_t)header.rows;
+            result.series.symbol = cached_symbol;
+            tail = (size_t)header.data_bytes;
+        }
+        
+        // Parse the appended rows: complete lines first, then any unterminated one
+        size_t complete = size;
+        while (complete > tail && data[complete - 1] != '\n') --complete;
+        PriceSeries fresh;
+        fresh.symbol = result.series.symbol;
+        FastCSVParser::parseRows(data + tail, data + complete, roles, fresh);
+        size_t committed = fresh.size();
+        FastCSVParser::parseRows(data + complete, data + size, roles, fresh);
+        result.parsed_rows = fresh.size();
+        result.series.symbol = fresh.symbol;
+        if (result.series.symbol.empty()) {
+            result.series.symbol = std::filesystem::path(filename).stem().string();
+        }
+        
+        size_t rows = result.cached_rows + fresh.size();
+        result.series.reserve(rows);
+        result.indicators.resize(rows);
+        if (!result.rebuilt) readRows(cache, entry, result);
+        cache.close();
+        
+        vector<CachedBar> appended(result.rebuilt ? 0 : committed);
+        string state;
+        for (size_t i = 0; i < fresh.size(); ++i) {
+            CachedBar bar;
+            bar.timestamp = fresh.timestamp[i];
+            bar.open = fresh.open[i];
+            bar.high = fresh.high[i];
+            bar.low = fresh.low[i];
+            bar.volume = fresh.volume[i];
+            bar.indicators = stream.update(fresh.close[i]);
+            appendBar(result, bar);
+            if (i < appended.size()) appended[i] = bar;
+            if (i + 1 == committed) state = saveState(stream);
+        }
+        
+        if (result.rebuilt || committed > 0) {
+            if (committed == 0) state = saveState(stream);
+            prefix.update(data + (result.rebuilt ? 0 : tail), complete - (result.rebuilt ? 0 : tail));
+            
+            IndicatorCacheHeader updated;
+            memset(&updated, 0, sizeof(updated));
+            memcpy(updated.magic, MAGIC, sizeof(updated.magic));
+            updated.version = VERSION;
+            updated.header_size = sizeof(IndicatorCacheHeader);
+            updated.indicator_key = indicatorKey();
+            updated.data_bytes = complete;
+            updated.data_hash = prefix.digest();
+            updated.rows = result.cached_rows + committed;
+            updated.state_bytes = state.size();
+            updated.state_hash = ContentHash::of(state.data(), state.size());
+            updated.symbol_bytes = result.series.symbol.size();
+            updated.entry_hash = entryHash(entry_symbol);
+            
+            if (result.rebuilt || state.size() != header.state_bytes || result.series.symbol != cached_symbol) {
+                writeCheckpoint(entry, updated, result.series.symbol, state, result);
+            } else {
+                appendCheckpoint(entry, updated, state, appended);
+            }
+        }
+        
+        scope.setBars(result.parsed_rows);
+        if (result.series.size() == 0) {
+            throw runtime_error("No valid price data found in file");
+        }
+        return result;
+    }
+    
+private:
+    // Validates the checkpoint at path against its entry and the source bytes,
+    // and restores its symbol and indicator state; cache is left at the first
+    // row. On success prefix holds the hash of the covered source prefix.
+    static bool openCheckpoint(const string& path, uint64_t entry_hash, const char* data, size_t size,
+                               size_t body, ifstream& cache, IndicatorCacheHeader& header, string& symbol,
+                               ContentHash& prefix, StreamingIndicators& stream) {
+        cache.open(path.c_str(), ios::binary);
+        if (!cache.is_open()) return false;
+        
+        cache.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!cache || memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != VERSION || header.header_size != sizeof(IndicatorCacheHeader) ||
+            header.indicator_key != indicatorKey() || header.entry_hash != entry_hash ||
+            header.data_bytes < body || header.data_bytes > size) {
+            return false;
+        }
+        cache.seekg(0, ios::end);
+        uint64_t cache_size = (uint64_t)cache.tellg();
+        if (cache_size < header.header_size + header.symbol_bytes + header.state_bytes +
+                             header.rows * sizeof(CachedBar)) {
+            return false;
+        }
+        
+        prefix.update(data, (size_t)header.data_bytes);
+        if (prefix.digest() != header.data_hash) return false;
+        
+        symbol.assign((size_t)header.symbol_bytes, '\0');
+        string state((size_t)header.state_bytes, '\0');
+        cache.seekg(header.header_size);
+        cache.read(&symbol[0], symbol.size());
+        cache.read(&state[0], state.size());
+        if (!cache || ContentHash::of(state.data(), state.size()) != header.state_hash) return false;
+        try {
+            istringstream in(state);
+            stream.loadState(in);
+        } catch (const exception&) {
+            return false;
+        }
+        return true;
+    }
+    
+    static void readRows(ifstream& cache, const string& path, CachedPrices& result) {
+        const size_t CHUNK = 4096;
+        vector<CachedBar> chunk(CHUNK);
+        for (size_t done = 0; done < result.cached_rows; ) {
+            size_t count = min(CHUNK, result.cached_rows - done);
+            cache.read(reinterpret_cast<char*>(chunk.data()), count * sizeof(CachedBar));
+            if (!cache) {
+                throw runtime_error("Truncated indicator cache: " + path);
+            }
+            for (size_t i = 0; i < count; ++i) appendBar(result, chunk[i]);
+            done += count;
+        }
+    }
+    
+    static void appendBar(CachedPrices& result, const CachedBar& bar) {
+        PriceSeries& series = result.series;
+        result.indicators.set(series.size(), bar.indicators);
+        series.timestamp.push_back(bar.timestamp);
+        series.open.push_back(bar.open);
+        series.high.push_back(bar.high);
+        series.low.push_back(bar.low);
+        series.close.push_back(bar.indicators.close);
+        series.volume.push_back(bar.volume);
+    }
+    
+    static string saveState(const StreamingIndicators& stream) {
+        ostringstream out;
+        stream.saveState(out);
+        return out.str();
+    }
+    
+    // Writes a complete checkpoint next to path and renames it into place. The
+    // temporary name is unique to this process and thread, so concurrent
+    // writers of one entry never share a file; the last rename wins.
+    static void writeCheckpoint(const string& path, const IndicatorCacheHeader& header, const string& symbol,
+                                const string& state, const CachedPrices& result) {
+        std::filesystem::path target(path);
+        if (target.has_parent_path()) std::filesystem::create_directories(target.parent_path());
+#ifdef _WIN32
+        unsigned long pid = (unsigned long)GetCurrentProcessId();
+#else
+        unsigned long pid = (unsigned long)getpid();
+#endif
+        string temp = path + ".tmp." + to_string(pid) + "." + to_string(hash<thread::id>()(this_thread::get_id()));
+        {
+            ofstream out(temp.c_str(), ios::binary | ios::trunc);
+            if (!out.is_open()) {
+                throw runtime_error("Cannot write indicator cache: " + temp);
+            }
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(symbol.data(), symbol.size());
+            out.write(state.data(), state.size());
+            
+            const PriceSeries& series = result.series;
+            vector<CachedBar> rows;
+            rows.reserve(min((size_t)header.rows, (size_t)4096));
+            for (size_t i = 0; i < (size_t)header.rows; ++i) {
+                CachedBar bar;
+                bar.timestamp = series.timestamp[i];
+                bar.open = series.open[i];
+                bar.high = series.high[i];
+                bar.low = series.low[i];
+                bar.volume = series.volume[i];
+                bar.indicators = result.indicators.at(i);
+                rows.push_back(bar);
+                if (rows.size() == rows.capacity()) {
+                    out.write(reinterpret_cast<const char*>(rows.data()), rows.size() * sizeof(CachedBar));
+                    rows.clear();
+                }
+            }
+            out.write(reinterpret_cast<const char*>(rows.data()), rows.size() * sizeof(CachedBar));
+            if (!out) {
+                throw runtime_error("Failed writing indicator cache: " + temp);
+            }
+        }
+        std::filesystem::rename(temp, target);
+    }
+    
+    // Appends rows after the existing ones, then replaces the state and the
+    // header. If a run is interrupted before the header is written, the old
+    // header either still matches (the extra rows are ignored and later
+    // overwritten) or fails its state hash, and the checkpoint is rebuilt.
+    static void appendCheckpoint(const string& path, const IndicatorCacheHeader& header,
+                                 const string& state, const vector<CachedBar>& appended) {
+        fstream out(path.c_str(), ios::binary | ios::in | ios::out);
+        if (!out.is_open()) {
+            throw runtime_error("Cannot write indicator cache: " + path);
+        }
+        size_t first_new = (size_t)header.rows - appended.size();
+        out.seekp((streamoff)(header.header_size + header.symbol_bytes + header.state_bytes +
+                              first_new * sizeof(CachedBar)));
+        out.write(reinterpret_cast<const char*>(appended.data()), appended.size() * sizeof(CachedBar));
+        out.flush();
+        out.seekp((streamoff)(header.header_size + header.symbol_bytes));
+        out.write(state.data(), state.size());
+        out.flush();
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (!out) {
+            throw runtime_error("Failed writing indicator cache: " + path);
+        }
+    }
+};
+
+// Work-stealing thread pool. Each worker owns a deque: it pops its own work
+// from the back and steals from the front of other workers' deques when idle.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count = 0)
+        : queued(0), pending(0), next_queue(0), stopping(false) {
+        if (thread_count == 0) thread_count = defaultThreadCount();
+        for (size_t i = 0; i < thread_count; ++i) {
+            queues.emplace_back(new WorkQueue());
+        }
+        for (size_t i = 0; i < thread_count; ++i) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+    
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(wake_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    static size_t defaultThreadCount() {
+        unsigned int cores = thread::hardware_concurrency();
+        return cores > 0 ? cores : 1;
+    }
+    
+    size_t size() const { return workers.size(); }
+    
+    // Index of the calling worker thread; only meaningful inside a task.
+    static size_t workerIndex() { return current_worker; }
+    
+    // Tasks submitted from a worker go to that worker's own deque; external
+    // submissions are spread round-robin.
+    void submit(function<void()> task) {
+        size_t index = (current_pool == this) ? current_worker
+                                              : next_queue.fetch_add(1) % queues.size();
+        pending.fetch_add(1);
+        {
+            lock_guard<mutex> lock(queues[index]->m);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        {
+            lock_guard<mutex> lock(wake_mutex);
+            queued++;
+        }
+        wake.notify_one();
+    }
+    
+    // Blocks until every submitted task has finished. Rethrows the first
+    // exception raised by a task, if any.
+    void wait() {
+        unique_lock<mutex> lock(wake_mutex);
+        done.wait(lock, [this] { return pending.load() == 0; });
+        if (first_error) {
+            exception_ptr error = first_error;
+            first_error = nullptr;
+            rethrow_exception(error);
+        }
+    }
+    
+    // Runs fn(i) for i in [0, count) and waits for completion. Must be called
+    // from outside the pool, not from one of its tasks.
+    template <typename Fn>
+    void parallelFor(size_t count, Fn fn) {
+        for (size_t i = 0; i < count; ++i) {
+            submit([&fn, i] { fn(i); });
+        }
+        wait();
+    }
+    
+private:
+    struct WorkQueue {
+        mutex m;
+        deque<function<void()>> tasks;
+    };
+    
+    bool popTask(size_t index, function<void()>& task) {
+        {
+            WorkQueue& own = *queues[index];
+            lock_guard<mutex> lock(own.m);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t offset = 1; offset < queues.size(); ++offset) {
+            WorkQueue& victim = *queues[(index + offset) % queues.size()];
+            lock_guard<mutex> lock(victim.m);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    void workerLoop(size_t index) {
+        current_pool = this;
+        current_worker = index;
+        
+        while (true) {
+            function<void()> task;
+            if (popTask(index, task)) {
+                queued.fetch_sub(1);
+                try {
+                    task();
+                } catch (...) {
+                    lock_guard<mutex> lock(wake_mutex);
+                    if (!first_error) first_error = current_exception();
+                }
+                if (pending.fetch_sub(1) == 1) {
+                    lock_guard<mutex> lock(wake_mutex);
+                    done.notify_all();
+                }
+                continue;
+            }
+            
+            unique_lock<mutex> lock(wake_mutex);
+            wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+            if (stopping && queued.load() == 0) return;
+        }
+    }
+    
+    vector<unique_ptr<WorkQueue>> queues;
+    vector<thread> workers;
+    atomic<size_t> queued;
+    atomic<size_t> pending;
+    atomic<size_t> next_queue;
+    mutex wake_mutex;
+    condition_variable wake;
+    condition_variable done;
+    bool stopping;
+    exception_ptr first_error;
+    
+    static thread_local ThreadPool* current_pool;
+    static thread_local size_t current_worker;
+};
+
+thread_local ThreadPool* ThreadPool::current_pool = nullptr;
+thread_local size_t ThreadPool::current_worker = 0;
+
+// Inputs of one rule evaluation.
+struct RuleContext {
+    const StrategyParams& params;
+    const IndicatorSnapshot& current;
+    const IndicatorSnapshot& prev;
+};
+
+// Inputs of a whole-series rule evaluation (see SignalMasks). Knobs taken from
+// StrategyParams lie in [low, high]. A loose evaluation picks, per
+// comparison, the bound that makes it hold most often and a tight one the
+// bound that makes it hold least; Not swaps the two. A loose mask therefore
+// covers every bar where the condition holds for some parameter set in the
+// range.
+struct MaskContext {
+    const IndicatorSet& indicators;
+    const StrategyParams& low;
+    const StrategyParams& high;
+    bool loose;
+    
+    const StrategyParams& bound(bool upper) const { return upper ? high : low; }
+    MaskContext negated() const { return MaskContext{indicators, low, high, !loose}; }
+};
+
+// Two-bar compares for the mask kernels: each returns the results for bars i
+// and i + 1 in bits 0 and 1. SSE2 is part of the x86-64 baseline, so unlike
+// the cross-symbol kernels these need no runtime dispatch.
+#if defined(__SSE2__) || defined(_M_X64)
+typedef __m128d BarPair;
+
+static inline BarPair pairLoad(const double* p) { return _mm_loadu_pd(p); }
+static inline BarPair pairSet(double x) { return _mm_set1_pd(x); }
+static inline BarPair pairMul(BarPair a, BarPair b) { return _mm_mul_pd(a, b); }
+static inline unsigned pairLess(BarPair a, BarPair b) { return (unsigned)_mm_movemask_pd(_mm_cmplt_pd(a, b)); }
+static inline unsigned pairLessEq(BarPair a, BarPair b) { return (unsigned)_mm_movemask_pd(_mm_cmple_pd(a, b)); }
+static inline unsigned pairGreater(BarPair a, BarPair b) { return (unsigned)_mm_movemask_pd(_mm_cmpgt_pd(a, b)); }
+static inline unsigned pairGreaterEq(BarPair a, BarPair b) { return (unsigned)_mm_movemask_pd(_mm_cmpge_pd(a, b)); }
+#else
+// Portable fallback
+struct BarPair {
+    double first, second;
+};
+
+static inline BarPair pairLoad(const double* p) { return BarPair{p[0], p[1]}; }
+static inline BarPair pairSet(double x) { return BarPair{x, x}; }
+static inline BarPair pairMul(BarPair a, BarPair b) { return BarPair{a.first * b.first, a.second * b.second}; }
+static inline unsigned pairLess(BarPair a, BarPair b) { return (a.first < b.first) | (a.second < b.second) << 1; }
+static inline unsigned pairLessEq(BarPair a, BarPair b) { return (a.first <= b.first) | (a.second <= b.second) << 1; }
+static inline unsigned pairGreater(BarPair a, BarPair b) { return (a.first > b.first) | (a.second > b.second) << 1; }
+static inline unsigned pairGreaterEq(BarPair a, BarPair b) { return (a.first >= b.first) | (a.second >= b.second) << 1; }
+#endif
+
+// One bit per bar, packed into 64-bit words.
+class BarMask {
+public:
+    static constexpr size_t WORD_BARS = 64;
+    
+    void resize(size_t bars) {
+        count = bars;
+        words.assign((bars + WORD_BARS - 1) / WORD_BARS, 0);
+    }
+    
+    size_t size() const { return count; }
+    size_t wordCount() const { return words.size(); }
+    
+    // Bars past size() are always clear.
+    void setWord(size_t w, uint64_t bits) {
+        size_t tail = count - w * WORD_BARS;
+        if (tail < WORD_BARS) bits &= ((uint64_t)1 << tail) - 1;
+        words[w] = bits;
+    }
+    
+    bool test(size_t i) const { return (words[i / WORD_BARS] >> (i % WORD_BARS)) & 1; }
+    
+    // First set bar at or after i, or size() if there is none.
+    size_t next(size_t i) const {
+        if (i >= count) return count;
+        size_t w = i / WORD_BARS;
+        uint64_t bits = words[w] & (~(uint64_t)0 << (i % WORD_BARS));
+        while (bits == 0) {
+            if (++w == words.size()) return count;
+            bits = words[w];
+        }
+        return w * WORD_BARS + lowestBit(bits);
+    }
+    
+private:
+    static size_t lowestBit(uint64_t bits) {
+#if defined(__GNUC__)
+        return (size_t)__builtin_ctzll(bits);
+#else
+        size_t index = 0;
+        while (!(bits & 1)) {
+            bits >>= 1;
+            index++;
+        }
+        return index;
+#endif
+    }
+    
+    size_t count = 0;
+    vector<uint64_t> words;
+};
+
+// One 64-bar word of a comparison: two bars per compare inside the series,
+// one bar at a time in the first word (Prev has no bar before 0) and in a
+// partial last word.
+template <typename Scalar, typename Pairwise>
+static inline uint64_t compareWord(const MaskContext& m, size_t w, Scalar scalar, Pairwise pairwise) {
+    size_t base = w * BarMask::WORD_BARS;
+    size_t bars = m.indicators.size();
+    uint64_t bits = 0;
+    if (base > 0 && base + BarMask::WORD_BARS <= bars) {
+        for (size_t j = 0; j < BarMask::WORD_BARS; j += 2) {
+            bits |= (uint64_t)pairwise(base + j) << j;
+        }
+    } else {
+        size_t count = min(BarMask::WORD_BARS, bars - base);
+        for (size_t j = 0; j < count; ++j) {
+            bits |= (uint64_t)scalar(base + j) << j;
+        }
+    }
+    return bits;
+}
+
+// Rule DSL. A condition is an empty type with a static test() for one bar and
+// a static word() for 64 bars of a whole series; conditions are combined with
+// And / Or / Not and attached to a signal reason with Rule, so a whole
+// strategy is a type that the compiler inlines into the backtest loop.
+//
+// Conditions compare operands: an indicator column at the current or the
+// previous bar, a constant, a StrategyParams knob, or a positive scaling of
+// another operand. Integer template arguments are RSI levels or percentages.
+template <IndicatorSet::Column C>
+static inline double snapshotField(const IndicatorSnapshot& s) {
+    switch (C) {
+        case IndicatorSet::CLOSE: return s.close;
+        case IndicatorSet::RSI: return s.rsi;
+        case IndicatorSet::RSI_SHORT: return s.rsi_short;
+        case IndicatorSet::MACD: return s.macd;
+        case IndicatorSet::MACD_SIGNAL: return s.macd_signal;
+        case IndicatorSet::MACD_HISTOGRAM: return s.macd_histogram;
+        case IndicatorSet::SMA_20: return s.sma_20;
+        case IndicatorSet::SMA_50: return s.sma_50;
+        case IndicatorSet::BB_LOWER: return s.bb_lower;
+        default: return 0.0;
+    }
+}
+
+template <IndicatorSet::Column C>
+struct Current {
+    static double value(const RuleContext& c) { return snapshotField<C>(c.current); }
+    static double at(const MaskContext& m, size_t i, bool) { return m.indicators.column(C)[i]; }
+    static BarPair pair(const MaskContext& m, size_t i, bool) { return pairLoad(m.indicators.column(C).data() + i); }
+};
+
+// Bar 0 stands in for its own predecessor; no signal is evaluated there.
+template <IndicatorSet::Column C>
+struct Previous {
+    static double value(const RuleContext& c) { return snapshotField<C>(c.prev); }
+    static double at(const MaskContext& m, size_t i, bool) { return m.indicators.column(C)[i > 0 ? i - 1 : 0]; }
+    static BarPair pair(const MaskContext& m, size_t i, bool) { return pairLoad(m.indicators.column(C).data() + i - 1); }
+};
+
+template <int V>
+struct Constant {
+    static double value(const RuleContext&) { return V; }
+    static double at(const MaskContext&, size_t, bool) { return V; }
+    static BarPair pair(const MaskContext&, size_t, bool) { return pairSet(V); }
+};
+
+template <double StrategyParams::*Field>
+struct Param {
+    static double value(const RuleContext& c) { return c.params.*Field; }
+    static double at(const MaskContext& m, size_t, bool upper) { return m.bound(upper).*Field; }
+    static BarPair pair(const MaskContext& m, size_t, bool upper) { return pairSet(m.bound(upper).*Field); }
+};
+
+// Operand times Num / Den (positive, so bounds keep their order)
+template <typename Operand, int Num, int Den>
+struct Scaled {
+    static_assert(Num > 0 && Den > 0, "Scaled only supports positive factors");
+    static double factor() { return (double)Num / Den; }
+    static double value(const RuleContext& c) { return Operand::value(c) * factor(); }
+    static double at(const MaskContext& m, size_t i, bool upper) { return Operand::at(m, i, upper) * factor(); }
+    static BarPair pair(const MaskContext& m, size_t i, bool upper) {
+        return pairMul(Operand::pair(m, i, upper), pairSet(factor()));
+    }
+};
+
+struct LessOp {
+    static const bool GREATER = false;
+    static bool scalar(double a, double b) { return a < b; }
+    static unsigned pair(BarPair a, BarPair b) { return pairLess(a, b); }
+};
+
+struct LessEqOp {
+    static const bool GREATER = false;
+    static bool scalar(double a, double b) { return a <= b; }
+    static unsigned pair(BarPair a, BarPair b) { return pairLessEq(a, b); }
+};
+
+struct GreaterOp {
+    static const bool GREATER = true;
+    static bool scalar(double a, double b) { return a > b; }
+    static unsigned pair(BarPair a, BarPair b) { return pairGreater(a, b); }
+};
+
+struct GreaterEqOp {
+    static const bool GREATER = true;
+    static bool scalar(double a, double b) { return a >= b; }
+    static unsigned pair(BarPair a, BarPair b) { return pairGreaterEq(a, b); }
+};
+
+template <typename Left, typename Right, typename Op>
+struct Compare {
+    static bool test(const RuleContext& c) { return Op::scalar(Left::value(c), Right::value(c)); }
+    
+    static uint64_t word(const MaskContext& m, size_t w) {
+        // A greater-than holds most often with the left side high
+        bool left_upper = Op::GREATER == m.loose;
+        return compareWord(m, w,
+            [&](size_t i) { return Op::scalar(Left::at(m, i, left_upper), Right::at(m, i, !left_upper)); },
+            [&](size_t i) { return Op::pair(Left::pair(m, i, left_upper), Right::pair(m, i, !left_upper)); });
+    }
+};
+
+template <typename Left, typename Right> using Less = Compare<Left, Right, LessOp>;
+template <typename Left, typename Right> using LessEq = Compare<Left, Right, LessEqOp>;
+template <typename Left, typename Right> using Greater = Compare<Left, Right, GreaterOp>;
+template <typename Left, typename Right> using GreaterEq = Compare<Left, Right, GreaterEqOp>;
+
+template <typename... Conditions>
+struct And {
+    static bool test(const RuleContext& c) { return (Conditions::test(c) && ...); }
+    static uint64_t word(const MaskContext& m, size_t w) { return (~(uint64_t)0 & ... & Conditions::word(m, w)); }
+};
+
+template <typename... Conditions>
+struct Or {
+    static bool test(const RuleContext& c) { return (Conditions::test(c) || ...); }
+    static uint64_t word(const MaskContext& m, size_t w) { return ((uint64_t)0 | ... | Conditions::word(m, w)); }
+};
+
+template <typename Condition>
+struct Not {
+    static bool test(const RuleContext& c) { return !Condition::test(c); }
+    static uint64_t word(const MaskContext& m, size_t w) { return ~Condition::word(m.negated(), w); }
+};
+
+template <int Level> using RsiBelow = Less<Current<IndicatorSet::RSI>, Constant<Level>>;
+template <int Level> using RsiAbove = Greater<Current<IndicatorSet::RSI>, Constant<Level>>;
+template <int Level> using ShortRsiBelow = Less<Current<IndicatorSet::RSI_SHORT>, Constant<Level>>;
+
+// RSI levels taken from StrategyParams, so sweeps can tune them
+using RsiOversold = Less<Current<IndicatorSet::RSI>, Param<&StrategyParams::rsi_oversold>>;
+using RsiOverbought = Greater<Current<IndicatorSet::RSI>, Param<&StrategyParams::rsi_overbought>>;
+using RsiAboveNeutral = Greater<Current<IndicatorSet::RSI>, Param<&StrategyParams::rsi_neutral_high>>;
+
+using MacdBullish = Greater<Current<IndicatorSet::MACD>, Current<IndicatorSet::MACD_SIGNAL>>;
+
+using MacdCrossUp = And<LessEq<Previous<IndicatorSet::MACD>, Previous<IndicatorSet::MACD_SIGNAL>>,
+                        Greater<Current<IndicatorSet::MACD>, Current<IndicatorSet::MACD_SIGNAL>>>;
+
+using MacdCrossDown = And<GreaterEq<Previous<IndicatorSet::MACD>, Previous<IndicatorSet::MACD_SIGNAL>>,
+                          Less<Current<IndicatorSet::MACD>, Current<IndicatorSet::MACD_SIGNAL>>>;
+
+using MacdHistogramRising = Greater<Current<IndicatorSet::MACD_HISTOGRAM>, Previous<IndicatorSet::MACD_HISTOGRAM>>;
+
+// Fast SMA above slow SMA. Only the 20/50 pair is precomputed.
+template <int Fast, int Slow>
+struct Uptrend : Greater<Current<IndicatorSet::SMA_20>, Current<IndicatorSet::SMA_50>> {
+    static_assert(Fast == 20 && Slow == 50, "IndicatorSet only provides SMA 20 and SMA 50");
+};
+
+// Fast SMA just crossed below slow SMA
+template <int Fast, int Slow>
+struct TrendTurnedDown : And<Not<Uptrend<Fast, Slow>>,
+                             Greater<Previous<IndicatorSet::SMA_20>, Previous<IndicatorSet::SMA_50>>> {};
+
+// Close within Pct percent above the lower Bollinger band
+template <int Pct>
+using NearLowerBand = LessEq<Current<IndicatorSet::CLOSE>, Scaled<Current<IndicatorSet::BB_LOWER>, 100 + Pct, 100>>;
+
+using PriceRising = Greater<Current<IndicatorSet::CLOSE>, Previous<IndicatorSet::CLOSE>>;
+
+template <typename Condition, uint16_t Reason>
+struct Rule {
+    using When = Condition;
+    static const uint16_t REASON = Reason;
+};
+
+// Ordered rule list: the first rule whose condition holds supplies the reason.
+template <typename... RuleList>
+struct Rules {
+    static bool match(const RuleContext& c, uint16_t& reason) {
+        return ((RuleList::When::test(c) ? (reason = RuleList::REASON, true) : false) || ...);
+    }
+    
+    // Bars where any rule holds
+    static uint64_t word(const MaskContext& m, size_t w) { return ((uint64_t)0 | ... | RuleList::When::word(m, w)); }
+};
+
+template <typename EntryRules, typename ExitRules>
+struct RuleSet {
+    using Entries = EntryRules;
+    using Exits = ExitRules;
+};
+
+// The original multi-indicator strategy
+using DefaultRules = RuleSet<
+    Rules<Rule<And<RsiOversold, ShortRsiBelow<30>, MacdBullish, Uptrend<20, 50>>, REASON_STRONG_OVERSOLD>,
+          Rule<And<MacdCrossUp, RsiAbove<30>, RsiBelow<60>, Uptrend<20, 50>>, REASON_MACD_CROSSOVER>,
+          Rule<And<NearLowerBand<2>, RsiBelow<35>, PriceRising>, REASON_BB_BOUNCE>,
+          Rule<And<RsiBelow<30>, Uptrend<20, 50>, MacdHistogramRising>, REASON_RSI_OVERSOLD_UPTREND>>,
+    Rules<Rule<And<RsiOverbought, Not<MacdBullish>>, REASON_RSI_OVERBOUGHT>,
+          Rule<And<MacdCrossDown, RsiAbove<50>>, REASON_MACD_BEARISH_CROSSOVER>,
+          Rule<TrendTurnedDown<20, 50>, REASON_TREND_REVERSAL>>>;
+
+// Rides MACD crossovers inside an SMA uptrend
+using TrendRules = RuleSet<
+    Rules<Rule<And<Uptrend<20, 50>, MacdCrossUp>, REASON_MACD_CROSSOVER>>,
+    Rules<Rule<TrendTurnedDown<20, 50>, REASON_TREND_REVERSAL>,
+          Rule<MacdCrossDown, REASON_MACD_BEARISH_CROSSOVER>>>;
+
+// Buys oversold dips and exits once RSI is back above neutral
+using MeanReversionRules = RuleSet<
+    Rules<Rule<And<RsiOversold, PriceRising>, REASON_RSI_MEAN_REVERSION>,
+          Rule<And<NearLowerBand<0>, RsiBelow<35>>, REASON_BB_BOUNCE>>,
+    Rules<Rule<RsiAboveNeutral, REASON_RSI_NEUTRAL_EXIT>,
+          Rule<RsiOverbought, REASON_RSI_OVERBOUGHT>>>;
+
+// Precompiled rule sets, selected at run time by StrategyParams::rule_set
+// ("rules = name" in a strategy config file). dispatch() hands the chosen
+// RuleSet type to a generic callable once per run, not per bar.
+class StrategyCatalog {
+public:
+    static const int COUNT = 3;
+    
+    static const char* name(int id) {
+        static const char* names[COUNT] = {"default", "trend", "mean_reversion"};
+        return id >= 0 && id < COUNT ? names[id] : "unknown";
+    }
+    
+    // Returns -1 for an unknown name.
+    static int find(const string& rule_name) {
+        for (int id = 0; id < COUNT; ++id) {
+            if (rule_name == name(id)) return id;
+        }
+        return -1;
+    }
+    
+    template <typename Fn>
+    static void dispatch(int id, Fn&& fn) {
+        switch (id) {
+            case 0: fn(DefaultRules()); return;
+            case 1: fn(TrendRules()); return;
+            case 2: fn(MeanReversionRules()); return;
+        }
+        throw runtime_error("Unknown rule set: " + to_string(id));
+    }
+};
+
+// Reads strategy settings from an INI-style file:
+//
+//   [strategy]
+//   rules = mean_reversion      ; a StrategyCatalog name
+//   rsi_oversold = 30
+//   stop_loss_pct = 0.05
+//
+// Keys are StrategyParams knob names. Section headers are optional and '#' or
+// ';' start a comment.
+class StrategyConfig {
+public:
+    static StrategyParams load(const string& filename, const StrategyParams& base = StrategyParams()) {
+        ifstream file(filename.c_str());
+        if (!file.is_open()) {
+            throw runtime_error("Cannot open strategy config: " + filename);
+        }
+        
+        StrategyParams params = base;
+        string line;
+        int line_number = 0;
+        while (getline(file, line)) {
+            line_number++;
+            size_t comment = line.find_first_of("#;");
+            if (comment != string::npos) line.erase(comment);
+            line = trim(line);
+            if (line.empty() || line[0] == '[') continue;
+            
+            size_t eq = line.find('=');
+            if (eq == string::npos) {
+                throw runtime_error(filename + ":" + to_string(line_number) + ": expected key = value");
+            }
+            string key = trim(line.substr(0, eq));
+            string value = trim(line.substr(eq + 1));
+            
+            if (key == "rules") {
+                int id = StrategyCatalog::find(value);
+                if (id < 0) {
+                    throw runtime_error(filename + ":" + to_string(line_number) + ": unknown rule set '" + value + "'");
+                }
+                params.rule_set = id;
+            } else if (!params.set(key, atof(value.c_str()))) {
+                throw runtime_error(filename + ":" + to_string(line_number) + ": unknown key '" + key + "'");
+            }
+        }
+        return params;
+    }
+    
+private:
+    static string trim(const string& text) {
+        size_t begin = text.find_first_not_of(" \t\r");
+        if (begin == string::npos) return "";
+        size_t end = text.find_last_not_of(" \t\r");
+        return text.substr(begin, end - begin + 1);
+    }
+};
+
+// Entry and exit candidate bars of a rule set over a whole IndicatorSet,
+// built 64 bars at a time with the conditions' word() kernels. Built from a
+// [low, high] range of StrategyParams, the masks are a superset of the bars
+// where the rules fire for any parameter set in the range, so one pair of
+// masks serves every trial of a sweep; the strategy still re-checks each
+// flagged bar exactly.
+class SignalMasks {
+public:
+    int rule_set = -1;
+    BarMask entry;                   // Some entry rule may hold
+    BarMask exit;                    // Some exit rule may hold
+    
+    static SignalMasks build(const IndicatorSet& indicators, const StrategyParams& low,
+                             const StrategyParams& high) {
+        if (low.rule_set != high.rule_set) {
+            throw runtime_error("Signal mask bounds use different rule sets");
+        }
+        
+        SignalMasks masks;
+        masks.rule_set = low.rule_set;
+        masks.entry.resize(indicators.size());
+        masks.exit.resize(indicators.size());
+        Profiler::Scope scope("signal masks", indicators.size());
+        
+        MaskContext context{indicators, low, high, true};
+        StrategyCatalog::dispatch(low.rule_set, [&](auto rules) {
+            using Set = decltype(rules);
+            for (size_t w = 0; w < masks.entry.wordCount(); ++w) {
+                masks.entry.setWord(w, Set::Entries::word(context, w));
+                masks.exit.setWord(w, Set::Exits::word(context, w));
+            }
+        });
+        return masks;
+    }
+    
+    // Masks valid for every trial using rule_set: the knobs' smallest and
+    // largest values across those trials bound the range.
+    static SignalMasks build(const IndicatorSet& indicators, const vector<StrategyParams>& trials, int rule_set) {
+        StrategyParams low, high;
+        bool found = false;
+        for (const auto& trial : trials) {
+            if (trial.rule_set != rule_set) continue;
+            if (!found) {
+                low = high = trial;
+                found = true;
+                continue;
+            }
+            low.rsi_oversold = min(low.rsi_oversold, trial.rsi_oversold);
+            high.rsi_oversold = max(high.rsi_oversold, trial.rsi_oversold);
+            low.rsi_overbought = min(low.rsi_overbought, trial.rsi_overbought);
+            high.rsi_overbought = max(high.rsi_overbought, trial.rsi_overbought);
+            low.rsi_neutral_low = min(low.rsi_neutral_low, trial.rsi_neutral_low);
+            high.rsi_neutral_low = max(high.rsi_neutral_low, trial.rsi_neutral_low);
+            low.rsi_neutral_high = min(low.rsi_neutral_high, trial.rsi_neutral_high);
+            high.rsi_neutral_high = max(high.rsi_neutral_high, trial.rsi_neutral_high);
+        }
+        if (!found) {
+            throw runtime_error("No trial uses rule set: " + to_string(rule_set));
+        }
+        return build(indicators, low, high);
+    }
+    
+    // Whether these masks were built for params' rule set over a series of
+    // the given length. The knob range is the caller's responsibility.
+    bool matches(const StrategyParams& params, size_t bars) const {
+        return rule_set == params.rule_set && entry.size() == bars;
+    }
+};
+
+// Entry/exit frame shared by AdvancedTradingStrategy and PortfolioEngine:
+// stop loss and take profit first, then the RuleSet's entry rules when flat
+// (and allowed to buy) or its exit rules when long. The caller owns the
+// position state; evaluate() only updates the losing-streak counter when it
+// exits on a stop loss or take profit.
+class SignalRules {
+public:
+    template <typename Set = DefaultRules>
+    static TradeAction evaluate(const StrategyParams& params, double shares, double entry_price,
+                                int& consecutive_losses, bool can_buy,
+                                const IndicatorSnapshot& current, const IndicatorSnapshot& prev,
+                                uint16_t& reason) {
+        // Risk management - Stop loss and take profit
+        if (shares > 0 && entry_price > 0) {
+            double current_return = (current.close - entry_price) / entry_price;
+            
+            // Stop loss
+            if (current_return <= -params.stop_loss_pct) {
+                consecutive_losses++;
+                reason = REASON_STOP_LOSS;
+                return TradeAction::Sell;
+            }
+            // Take profit
+            if (current_return >= params.take_profit_pct) {
+                consecutive_losses = 0;
+                reason = REASON_TAKE_PROFIT;
+                return TradeAction::Sell;
+            }
+        }
+        
+        if (shares == 0 && can_buy && entrySignal<Set>(params, consecutive_losses, current, prev, reason)) {
+            return TradeAction::Buy;
+        }
+        if (shares > 0 && exitSignal<Set>(params, current, prev, reason)) {
+            return TradeAction::Sell;
+        }
+        
+        reason = REASON_NO_SIGNAL;
+        return TradeAction::Hold;
+    }
+    
+    // The rule set's entry rules alone, for callers that place their own
+    // protective orders (see ExecutionEngine).
+    template <typename Set>
+    static bool entrySignal(const StrategyParams& params, int consecutive_losses,
+                            const IndicatorSnapshot& current, const IndicatorSnapshot& prev, uint16_t& reason) {
+        RuleContext context{params, current, prev};
+        return consecutive_losses < params.max_consecutive_losses && Set::Entries::match(context, reason);
+    }
+    
+    template <typename Set>
+    static bool exitSignal(const StrategyParams& params, const IndicatorSnapshot& current,
+                           const IndicatorSnapshot& prev, uint16_t& reason) {
+        RuleContext context{params, current, prev};
+        return Set::Exits::match(context, reason);
+    }
+};
+
+class AdvancedTradingStrategy {
+private:
+    double cash;
+    double shares;
+    double initial_capital;
+    TradeLog trade_log;
+    MetricsAccumulator accumulator;
+    
+    StrategyParams params;
+    
+    double entry_price = 0.0;
+    int consecutive_losses = 0;
+    
+    bool verbose = true;             // Print progress to stdout
+    bool print_trades = false;       // Print every fill to stdout
+    bool record_history = true;      // Append every bar to trade_log
+    
+    // Live (step) mode state
+    StreamingIndicators live_indicators;
+    IndicatorSnapshot live_prev;
+    size_t live_bars = 0;
+    
+public:
+    static constexpr size_t WARMUP_BARS = 50;  // Bars before the first signal
+    
+    AdvancedTradingStrategy(double initial_cash = 100000.0, const StrategyParams& params = StrategyParams()) 
+        : cash(initial_cash), shares(0.0), initial_capital(initial_cash), accumulator(initial_cash), params(params) {}
+    
+    void backtest(const vector<PriceData>& price_data) {
+        backtestBars(price_data, TechnicalIndicators::calculateStrategyIndicators(price_data), 0, price_data.size());
+    }
+    
+    // Columnar overloads: bars are read from the view in place (e.g. the
+    // memory-mapped columns of an .fsx file) instead of a PriceData copy.
+    void backtest(const PriceView& bars) {
+        backtestBars(bars, TechnicalIndicators::calculateStrategyIndicators(bars), 0, bars.size());
+    }
+    
+    // Runs the strategy against precomputed indicators for price_data.
+    void backtest(const vector<PriceData>& price_data, const IndicatorSet& indicators) {
+        backtestBars(price_data, indicators, 0, price_data.size());
+    }
+    
+    void backtest(const PriceView& bars, const IndicatorSet& indicators) {
+        backtestBars(bars, indicators, 0, bars.size());
+    }
+    
+    // Runs the strategy over bars [begin, end) only. The indicators cover the
+    // whole series, so a window that starts past WARMUP_BARS trades from its
+    // first bar with already warmed-up values.
+    void backtest(const vector<PriceData>& price_data, const IndicatorSet& indicators,
+                  size_t begin, size_t end) {
+        backtestBars(price_data, indicators, begin, end);
+    }
+    
+    void backtest(const PriceView& bars, const IndicatorSet& indicators, size_t begin, size_t end) {
+        backtestBars(bars, indicators, begin, end);
+    }
+    
+    // Same run as backtest(price_data, indicators, begin, end) for any
+    // parameters covered by masks, but the rules are only evaluated on bars
+    // flagged in the entry mask while flat or the exit mask while long. Flat
+    // stretches between candidates are booked in bulk; long bars only check
+    // the stop loss and take profit.
+    void backtest(const vector<PriceData>& price_data, const IndicatorSet& indicators,
+                  size_t begin, size_t end, const SignalMasks& masks) {
+        backtestBars(price_data, indicators, begin, end, masks);
+    }
+    
+    void backtest(const PriceView& bars, const IndicatorSet& indicators, size_t begin, size_t end,
+                  const SignalMasks& masks) {
+        backtestBars(bars, indicators, begin, end, masks);
+    }
+    
+    // Streaming mode: advances the live indicators by one bar in O(1) and
+    // returns that bar's signal. The first WARMUP_BARS bars only warm the
+    // indicators up (HOLD, "Warming up") and are not recorded, so feeding a
+    // series bar by bar yields the same trade history as backtest().
+    TradingSignal step(const PriceData& bar) {
+        IndicatorSnapshot current = live_indicators.update(bar.close);
+        uint32_t index = (uint32_t)live_bars++;
+        if (index < WARMUP_BARS) {
+            live_prev = current;
+            return makeSignal(bar, TradeAction::Hold, REASON_WARMING_UP, current, index);
+        }
+        
+        TradingSignal signal;
+        StrategyCatalog::dispatch(params.rule_set, [&](auto rules) {
+            signal = processBar<decltype(rules)>(bar, current, live_prev, index);
+        });
+        live_prev = current;
+        accumulator.addBar(signal.portfolio_value, shares * signal.price);
+        if (record_history) {
+            trade_log.record(signal);
+        }
+        return signal;
+    }
+    
+    // Stops backtest() and step() from appending to the trade history, e.g.
+    // for a long-running live feed that only consumes the returned signals,
+    // or a sweep that only needs the metrics.
+    void setRecordHistory(bool enabled) { record_history = enabled; }
+    
+    const TradeLog& getTradeLog() const { return trade_log; }
+    const MetricsAccumulator& getMetrics() const { return accumulator; }
+    
+    // Starts a new run with fresh capital and parameters. The trade log keeps
+    // its capacity, so a strategy reused across runs does not reallocate.
+    void reset(double initial_cash, const StrategyParams& new_params) {
+        cash = initial_cash;
+        shares = 0.0;
+        initial_capital = initial_cash;
+        params = new_params;
+        entry_price = 0.0;
+        consecutive_losses = 0;
+        trade_log.clear();
+        accumulator.reset(initial_cash);
+        live_indicators.reset();
+        live_prev = IndicatorSnapshot();
+        live_bars = 0;
+    }
+    
+private:
+    static const PriceData& barAt(const vector<PriceData>& price_data, size_t i) { return price_data[i]; }
+    static PriceData barAt(const PriceView& bars, size_t i) { return bars.at(i); }
+    
+    // Bars is a vector<PriceData> or a PriceView; see barAt().
+    template <typename Bars>
+    void backtestBars(const Bars& price_data, const IndicatorSet& indicators, size_t begin, size_t end) {
+        if (price_data.size() < WARMUP_BARS) {
+            throw runtime_error("Insufficient data for backtesting");
+        }
+        
+        if (indicators.size() != price_data.size()) {
+            throw runtime_error("Indicator set does not match price data");
+        }
+        
+        if (begin >= end || end > price_data.size()) {
+            throw runtime_error("Invalid backtest window");
+        }
+        
+        if (record_history) {
+            trade_log.reserve(trade_log.bars() + (end - begin));
+        }
+        
+        if (verbose) {
+            cout << "Starting backtest with " << (end - begin) << " data points..." << endl;
+            cout << "Initial capital: $" << initial_capital << endl << endl;
+        }
+        
+        // Start trading after indicators stabilize
+        size_t first = max(begin, WARMUP_BARS);
+        Profiler::Scope scope("backtest", end > first ? end - first : 0);
+        
+        // Pick the compiled rule set once; the bar loop is instantiated per set
+        StrategyCatalog::dispatch(params.rule_set, [&](auto rules) {
+            using Set = decltype(rules);
+            IndicatorSnapshot prev = indicators.at(first - 1);
+            for (size_t i = first; i < end; ++i) {
+                IndicatorSnapshot current = indicators.at(i);
+                TradingSignal signal = processBar<Set>(barAt(price_data, i), current, prev, (uint32_t)i);
+                accumulator.addBar(signal.portfolio_value, shares * signal.price);
+                if (record_history) {
+                    trade_log.record(signal);
+                }
+                prev = current;
+            }
+        });
+        
+        if (verbose) {
+            cout << "\nBacktest completed!" << endl;
+        }
+    }
+    
+    template <typename Bars>
+    void backtestBars(const Bars& price_data, const IndicatorSet& indicators, size_t begin, size_t end,
+                      const SignalMasks& masks) {
+        if (price_data.size() < WARMUP_BARS) {
+            throw runtime_error("Insufficient data for backtesting");
+        }
+        
+        if (indicators.size() != price_data.size()) {
+            throw runtime_error("Indicator set does not match price data");
+        }
+        
+        if (!masks.matches(params, price_data.size())) {
+            throw runtime_error("Signal masks do not match this strategy");
+        }
+        
+        if (begin >= end || end > price_data.size()) {
+            throw runtime_error("Invalid backtest window");
+        }
+        
+        if (record_history) {
+            trade_log.reserve(trade_log.bars() + (end - begin));
+        }
+        
+        if (verbose) {
+            cout << "Starting backtest with " << (end - begin) << " data points..." << endl;
+            cout << "Initial capital: $" << initial_capital << endl << endl;
+        }
+        
+        size_t first = max(begin, WARMUP_BARS);
+        Profiler::Scope scope("backtest", end > first ? end - first : 0);
+        
+        StrategyCatalog::dispatch(params.rule_set, [&](auto rules) {
+            using Set = decltype(rules);
+            size_t i = first;
+            while (i < end) {
+                if (shares == 0) {
+                    // Flat: nothing changes before the next entry candidate,
+                    // and nothing at all once the losing streak blocks buying
+                    size_t next = consecutive_losses < params.max_consecutive_losses
+                                      ? min(end, masks.entry.next(i)) : end;
+                    if (next > i) {
+                        accumulator.addFlatBars(next - i, cash);
+                        if (record_history) {
+                            trade_log.recordHold(cash, next - i);
+                        }
+                        i = next;
+                        continue;
+                    }
+                } else {
+                    // Long: until the next exit candidate only the stop loss
+                    // or take profit can fire. Held bars are booked in blocks.
+                    size_t exit_bar = min(end, masks.exit.next(i));
+                    const double* closes = indicators.close().data();
+                    double value[BarMask::WORD_BARS];
+                    double market[BarMask::WORD_BARS];
+                    size_t held = 0;
+                    while (i < exit_bar) {
+                        double current_return = (closes[i] - entry_price) / entry_price;
+                        if (current_return <= -params.stop_loss_pct || current_return >= params.take_profit_pct) {
+                            break;
+                        }
+                        market[held] = shares * closes[i];
+                        value[held] = cash + market[held];
+                        ++i;
+                        if (++held == BarMask::WORD_BARS) {
+                            accumulator.addBars(value, market, held);
+                            if (record_history) {
+                                trade_log.recordHolds(value, held);
+                            }
+                            held = 0;
+                        }
+                    }
+                    if (held > 0) {
+                        accumulator.addBars(value, market, held);
+                        if (record_history) {
+                            trade_log.recordHolds(value, held);
+                        }
+                    }
+                    if (i == end) break;
+                }
+                
+                TradingSignal signal = processBar<Set>(barAt(price_data, i), indicators.at(i), indicators.at(i - 1), (uint32_t)i);
+                accumulator.addBar(signal.portfolio_value, shares * signal.price);
+                if (record_history) {
+                    trade_log.record(signal);
+                }
+                ++i;
+            }
+        });
+        
+        if (verbose) {
+            cout << "\nBacktest completed!" << endl;
+        }
+    }
+    
+    // Applies the entry/exit rules to one bar given its indicator values and
+    // the previous bar's, and returns the resulting signal.
+    template <typename Set>
+    TradingSignal processBar(const PriceData& bar, const IndicatorSnapshot& current,
+                             const IndicatorSnapshot& prev, uint32_t index) {
+        uint16_t reason = REASON_NO_SIGNAL;
+        TradeAction action = SignalRules::evaluate<Set>(params, shares, entry_price, consecutive_losses,
+                                                   cash > current.close, current, prev, reason);
+        if (action == TradeAction::Hold) {
+            // Record portfolio value
+            return makeSignal(bar, TradeAction::Hold, REASON_NO_SIGNAL, current, index);
+        }
+        return executeTrade(bar, action, reason, current, index);
+    }
+    
+    TradingSignal makeSignal(const PriceData& bar, TradeAction action, uint16_t reason,
+                             const IndicatorSnapshot& indicators, uint32_t index) const {
+        TradingSignal signal;
+        signal.timestamp = bar.timestamp;
+        signal.bar = index;
+        signal.action = action;
+        signal.reason = reason;
+        signal.price = bar.close;
+        signal.rsi = indicators.rsi;
+        signal.macd = indicators.macd;
+        signal.signal = indicators.macd_signal;
+        signal.portfolio_value = cash + shares * bar.close;
+        return signal;
+    }
+    
+    TradingSignal executeTrade(const PriceData& data, TradeAction action, uint16_t reason,
+                               const IndicatorSnapshot& indicators, uint32_t index) {
+        if (action == TradeAction::Buy && shares == 0 && cash > data.close) {
+            double investment = cash * params.position_size_pct;
+            shares = investment / data.close;
+            cash -= shares * data.close;
+            entry_price = data.close;
+            accumulator.addFill(action, data.close, shares);
+            
+            if (print_trades) {
+                cout << "BUY:  " << Timestamp::format(data.timestamp) << " at $" << fixed << setprecision(2) 
+                     << data.close << " - " << ReasonTable::name(reason) 
+                     << " (RSI: " << setprecision(1) << indicators.rsi << ")\n";
+            }
+        }
+        else if (action == TradeAction::Sell && shares > 0) {
+            double sale_proceeds = shares * data.close;
+            double profit = sale_proceeds - (shares * entry_price);
+            accumulator.addFill(action, data.close, shares);
+            cash += sale_proceeds;
+            shares = 0;
+            
+            if (print_trades) {
+                cout << "SELL: " << Timestamp::format(data.timestamp) << " at $" << fixed << setprecision(2) 
+                     << data.close << " - " << ReasonTable::name(reason) 
+                     << " (Profit: $" << profit << ")\n";
+            }
+            
+            entry_price = 0;
+        }
+        
+        return makeSignal(data, action, reason, indicators, index);
+    }
+    
+public:
+    void setVerbose(bool enabled) { verbose = enabled; }
+    
+    // Per-fill console lines are opt-in (--print-trades); they are written
+    // without flushing.
+    void setPrintTrades(bool enabled) { print_trades = enabled; }
+    
+    PerformanceMetrics calculatePerformanceMetrics(const vector<PriceData>& price_data) const {
+        return calculatePerformanceMetrics(price_data, 0, price_data.size());
+    }
+    
+    PerformanceMetrics calculatePerformanceMetrics(const PriceView& bars) const {
+        return calculatePerformanceMetrics(bars, 0, bars.size());
+    }
+    
+    // Metrics for a run over bars [begin, end); buy & hold is measured over
+    // the same window.
+    PerformanceMetrics calculatePerformanceMetrics(const vector<PriceData>& price_data,
+                                                   size_t begin, size_t end) const {
+        if (begin >= end || end > price_data.size()) return calculateMetrics(0.0, 0.0, false);
+        return calculateMetrics(price_data[begin].close, price_data[end - 1].close, true);
+    }
+    
+    PerformanceMetrics calculatePerformanceMetrics(const PriceView& bars, size_t begin, size_t end) const {
+        if (begin >= end || end > bars.size()) return calculateMetrics(0.0, 0.0, false);
+        return calculateMetrics(bars.close[begin], bars.close[end - 1], true);
+    }
+    
+    void printPerformanceMetrics(const vector<PriceData>& price_data) {
+        printMetrics(calculatePerformanceMetrics(price_data));
+    }
+    
+    void printPerformanceMetrics(const PriceView& bars) {
+        printMetrics(calculatePerformanceMetrics(bars));
+    }
+    
+private:
+    // start_price / final_price: closes of the window's first and last bar
+    PerformanceMetrics calculateMetrics(double start_price, double final_price, bool valid_window) const {
+        Profiler::Scope scope("metrics");
+        PerformanceMetrics metrics;
+        metrics.initial_capital = initial_capital;
+        metrics.cash = cash;
+        metrics.shares = shares;
+        metrics.has_history = accumulator.bars() > 0;
+        if (!metrics.has_history || !valid_window) {
+            return metrics;
+        }
+        
+        metrics.final_value = cash + shares * final_price;
+        metrics.total_return = (metrics.final_value - initial_capital) / initial_capital;
+        metrics.buy_hold_return = (final_price - start_price) / start_price;
+        metrics.unrealized_pnl = shares * (final_price - entry_price);
+        
+        metrics.buy_trades = accumulator.buyTrades();
+        metrics.sell_trades = accumulator.sellTrades();
+        metrics.win_rate = accumulator.winRate();
+        metrics.sharpe = accumulator.sharpe();
+        metrics.sortino = accumulator.sortino();
+        metrics.max_drawdown = accumulator.maxDrawdown();
+        metrics.max_drawdown_bars = accumulator.maxDrawdownBars();
+        metrics.exposure = accumulator.exposure();
+        metrics.turnover = accumulator.turnover();
+        return metrics;
+    }
+    
+    static void printMetrics(const PerformanceMetrics& metrics) {
+        if (!metrics.has_history) {
+            cout << "No trading history available." << endl;
+            return;
+        }
+        
+        cout << "\n" << string(60, '=') << endl;
+        cout << "ADVANCED TRADING STRATEGY RESULTS" << endl;
+        cout << string(60, '=') << endl;
+        cout << fixed << setprecision(2);
+        cout << "Initial Capital:        $" << metrics.initial_capital << endl;
+        cout << "Final Portfolio:        $" << metrics.final_value << endl;
+        cout << "Total Return:           " << (metrics.total_return * 100) << "%" << endl;
+        cout << "Buy & Hold Return:      " << (metrics.buy_hold_return * 100) << "%" << endl;
+        cout << "Alpha (Excess Return):  " << (metrics.alpha() * 100) << "%" << endl;
+        cout << "Sharpe Ratio:           " << setprecision(3) << metrics.sharpe << endl;
+        cout << "Sortino Ratio:          " << metrics.sortino << endl;
+        cout << "Max Drawdown:           " << setprecision(2) << (metrics.max_drawdown * 100) << "%" << endl;
+        cout << "Longest Drawdown:       " << metrics.max_drawdown_bars << " bars" << endl;
+        cout << "Time in Market:         " << (metrics.exposure * 100) << "%" << endl;
+        cout << "Turnover:               " << metrics.turnover << "x" << endl;
+        cout << "Total Buy Trades:       " << metrics.buy_trades << endl;
+        cout << "Total Sell Trades:      " << metrics.sell_trades << endl;
+        cout << "Win Rate:               " << metrics.win_rate << "%" << endl;
+        cout << "Current Position:       " << (metrics.shares > 0 ? "LONG" : "CASH") << endl;
+        cout << "Cash Remaining:         $" << metrics.cash << endl;
+        if (metrics.shares > 0) {
+            cout << "Shares Held:            " << setprecision(0) << metrics.shares << endl;
+            cout << "Unrealized P&L:         $" << setprecision(2) << metrics.unrealized_pnl << endl;
+        }
+
+    }
+};
+
+// Synthetic OHLCV data for benchmarks: a geometric random walk of daily bars.
+class SyntheticData {
+public:
+    static PriceSeries randomWalk(size_t bars, uint64_t seed, double start_price = 100.0,
+                                  double volatility = 0.01) {
+        PriceSeries series;
+        series.symbol = "SYN" + to_string(seed);
+        series.reserve(bars);
+        
+        mt19937_64 rng(seed);
+        normal_distribution<double> shock(0.0, volatility);
+        double price = start_price;
+        int64_t day = Timestamp::daysFromCivil(2000, 1, 3);
+        for (size_t i = 0; i < bars; ++i) {
+            double open = price;
+            price *= exp(shock(rng));
+            double spread = fabs(shock(rng)) * price;
+            series.timestamp.push_back((day + (int64_t)i) * Timestamp::SECONDS_PER_DAY);
+            series.open.push_back(open);
+            series.high.push_back(max(open, price) + spread);
+            series.low.push_back(min(open, price) - spread);
+            series.close.push_back(price);
+            series.volume.push_back(1e6);
+        }
+        return series;
+    }
+};
+
+struct BatchJob {
+    string symbol;
+    string path;
+};
+
+struct BatchResult {
+    string symbol;
+    size_t bars = 0;
+    PerformanceMetrics metrics;
+    string error;
+    vector<TradingSignal> fills;     // Only kept when a trade log is written
+};
+
+// Bounded single-producer / single-consumer queue. Only the producer writes
+// tail and only the consumer writes head, so neither side ever locks; each
+// side keeps a cached copy of the other's index to avoid touching the shared
+// cache line on every call.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity = 1024) : head(0), tail(0) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+    
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+    
+    // Producer side; false when the ring is full.
+    bool tryPush(const T& item) {
+        size_t t = tail.load(memory_order_relaxed);
+        if (t - head_cache == slots.size()) {
+            head_cache = head.load(memory_order_acquire);
+            if (t - head_cache == slots.size()) return false;
+        }
+        slots[t & mask] = item;
+        tail.store(t + 1, memory_order_release);
+        return true;
+    }
+    
+    // Consumer side; false when the ring is empty.
+    bool tryPop(T& item) {
+        size_t h = head.load(memory_order_relaxed);
+        if (h == tail_cache) {
+            tail_cache = tail.load(memory_order_acquire);
+            if (h == tail_cache) return false;
+        }
+        item = slots[h & mask];
+        head.store(h + 1, memory_order_release);
+        return true;
+    }
+    
+private:
+    vector<T> slots;
+    size_t mask = 0;
+    alignas(64) atomic<size_t> head;
+    size_t tail_cache = 0;           // Consumer's view of tail
+    alignas(64) atomic<size_t> tail;
+    size_t head_cache = 0;           // Producer's view of head
+};
+
+// Output files of a ResultSink; empty paths are skipped.
+struct ResultSinkConfig {
+    string trades_csv;               // trade_log.csv layout: Date,Price,Action
+    bool trades_symbol = false;      // Append Symbol,Reason,PortfolioValue columns
+    string trades_binary;            // Fixed-size TradeRecord rows after a TradeFileHeader
+    ostream* runs = nullptr;         // One row per finished run, written by run_writer
+    void (*run_writer)(ostream&, const BatchResult&) = nullptr;
+};
+
+// Collects fills and finished runs from worker threads and writes them from
+// one background thread. Every producer (e.g. a ThreadPool worker) owns an
+// SpscRing, so pushing never takes a lock or waits on another worker; the
+// writer drains the rings into large buffers and writes them in batches,
+// instead of each worker streaming (and flushing) through cout.
+class ResultSink {
+public:
+    static const size_t BUFFER_BYTES = 1 << 20;   // Written once this full
+    
+    // Binary trade file layout
+    struct TradeFileHeader {
+        char magic[8];               // "FSXTRADE"
+        uint32_t record_size;
+        uint32_t run_count;
+    };
+    
+    struct TradeRecord {
+        int64_t timestamp;
+        uint32_t run;
+        uint32_t bar;
+        uint8_t action;              // TradeAction
+        uint8_t reserved;
+        uint16_t reason;             // ReasonTable ID
+        uint32_t padding;
+        double price;
+        double portfolio_value;
+    };
+    static_assert(sizeof(TradeRecord) == 40, "TradeRecord layout must not depend on the compiler");
+    
+    // run_names label the Symbol column of the trade log.
+    ResultSink(size_t producers, const vector<string>& run_names, const ResultSinkConfig& config)
+        : config(config), run_names(run_names), closing(false) {
+        for (size_t p = 0; p < max((size_t)1, producers); ++p) {
+            rings.emplace_back(new SpscRing<Record>(RING_CAPACITY));
+        }
+        
+        if (!config.trades_csv.empty()) {
+            trades_csv.open(config.trades_csv.c_str(), ios::binary);
+            if (!trades_csv.is_open()) {
+                throw runtime_error("Cannot open output file: " + config.trades_csv);
+            }
+            csv_buffer = config.trades_symbol ? "Date,Price,Action,Symbol,Reason,PortfolioValue\n"
+                                              : "Date,Price,Action\n";
+        }
+        if (!config.trades_binary.empty()) {
+            trades_binary.open(config.trades_binary.c_str(), ios::binary);
+            if (!trades_binary.is_open()) {
+                throw runtime_error("Cannot open output file: " + config.trades_binary);
+            }
+            TradeFileHeader header;
+            memcpy(header.magic, "FSXTRADE", 8);
+            header.record_size = sizeof(TradeRecord);
+            header.run_count = (uint32_t)run_names.size();
+            trades_binary.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        }
+        
+        writer = thread(&ResultSink::writerLoop, this);
+    }
+    
+    ResultSink(const ResultSink&) = delete;
+    ResultSink& operator=(const ResultSink&) = delete;
+    
+    ~ResultSink() {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+    
+    bool writesTrades() const { return !config.trades_csv.empty() || !config.trades_binary.empty(); }
+    
+    // Each producer index must only be used by one thread at a time. A full
+    // ring makes the producer wait for the writer.
+    void pushFill(size_t producer, uint32_t run, const TradingSignal& fill) {
+        push(producer, Record{Record::FILL, run, fill, nullptr});
+    }
+    
+    // result must stay unchanged until close().
+    void pushRun(size_t producer, uint32_t run, const BatchResult& result) {
+        push(producer, Record{Record::RUN, run, TradingSignal(), &result});
+    }
+    
+    // Writes everything pushed so far and stops the writer. Producers must
+    // have finished pushing.
+    void close() {
+        if (!writer.joinable()) return;
+        closing.store(true, memory_order_release);
+        writer.join();
+        if (config.runs) config.runs->flush();
+        if (writer_error) rethrow_exception(writer_error);
+    }
+    
+private:
+    static const size_t RING_CAPACITY = 4096;
+    
+    struct Record {
+        enum Kind : uint8_t { FILL, RUN } kind;
+        uint32_t run;
+        TradingSignal fill;          // FILL
+        const BatchResult* result;   // RUN
+    };
+    
+    void push(size_t producer, const Record& record) {
+        SpscRing<Record>& ring = *rings[producer];
+        while (!ring.tryPush(record)) {
+            this_thread::yield();
+        }
+    }
+    
+    void writerLoop() {
+        try {
+            Record record;
+            size_t idle = 0;
+            while (true) {
+                // Read the flag first: if it was set, every push before it is
+                // visible to the drain below
+                bool last_pass = closing.load(memory_order_acquire);
+                bool drained = false;
+                for (auto& ring : rings) {
+                    while (ring->tryPop(record)) {
+                        write(record);
+                        drained = true;
+                    }
+                }
+                if (last_pass) break;
+                if (drained) {
+                    idle = 0;
+                } else if (++idle < 64) {
+                    this_thread::yield();
+                } else {
+                    this_thread::sleep_for(chrono::microseconds(200));
+                }
+            }
+            flushTrades();
+        } catch (...) {
+            writer_error = current_exception();
+        }
+    }
+    
+    void write(const Record& record) {
+        if (record.kind == Record::RUN) {
+            if (config.runs && config.run_writer) config.run_writer(*config.runs, *record.result);
+            return;
+        }
+        
+        const TradingSignal& fill = record.fill;
+        if (trades_csv.is_open()) {
+            char text[128];
+            size_t length = Timestamp::format(fill.timestamp, text);
+            text[length++] = ',';
+            length += formatNumber(fill.price, text + length);
+            text[length++] = ',';
+            csv_buffer.append(text, length);
+            csv_buffer += actionName(fill.action);
+            if (config.trades_symbol) {
+                csv_buffer += ',';
+                csv_buffer += record.run < run_names.size() ? run_names[record.run] : to_string(record.run);
+                csv_buffer += ',';
+                csv_buffer += ReasonTable::name(fill.reason);
+                csv_buffer += ',';
+                length = (size_t)(to_chars(text, text + 32, fill.portfolio_value, chars_format::fixed, 2).ptr - text);
+                csv_buffer.append(text, length);
+            }
+            csv_buffer += '\n';
+        }
+        if (trades_binary.is_open()) {
+            TradeRecord row;
+            row.timestamp = fill.timestamp;
+            row.run = record.run;
+            row.bar = fill.bar;
+            row.action = (uint8_t)fill.action;
+            row.reserved = 0;
+            row.reason = fill.reason;
+            row.padding = 0;
+            row.price = fill.price;
+            row.portfolio_value = fill.portfolio_value;
+            binary_buffer.append(reinterpret_cast<const char*>(&row), sizeof(row));
+        }
+        if (csv_buffer.size() >= BUFFER_BYTES || binary_buffer.size() >= BUFFER_BYTES) {
+            flushTrades();
+        }
+    }
+    
+    // Six significant digits, like an ostream's default formatting
+    static size_t formatNumber(double value, char* text) {
+        return (size_t)(to_chars(text, text + 32, value, chars_format::general, 6).ptr - text);
+    }
+    
+    void flushTrades() {
+        if (trades_csv.is_open()) {
+            trades_csv.write(csv_buffer.data(), csv_buffer.size());
+            csv_buffer.clear();
+            trades_csv.flush();
+        }
+        if (trades_binary.is_open()) {
+            trades_binary.write(binary_buffer.data(), binary_buffer.size());
+            binary_buffer.clear();
+            trades_binary.flush();
+        }
+    }
+    
+    ResultSinkConfig config;
+    vector<string> run_names;
+    vector<unique_ptr<SpscRing<Record>>> rings;
+    ofstream trades_csv;
+    ofstream trades_binary;
+    string csv_buffer;
+    string binary_buffer;
+    atomic<bool> closing;
+    thread writer;
+    exception_ptr writer_error;
+};
+
+// Runs the load -> indicators -> backtest -> metrics pipeline for many symbols
+// on a ThreadPool and writes one combined results table.
+class BatchRunner {
+public:
+    // Accepts a directory of per-symbol CSV or .fsx files (symbol = file stem)
+    // or a manifest file with one "path" or "SYMBOL,path" entry per line.
+    static vector<BatchJob> discoverJobs(const string& source) {
+        namespace fs = std::filesystem;
+        vector<BatchJob> jobs;
+        fs::path source_path(source);
+        
+        if (fs::is_directory(source_path)) {
+            for (const auto& entry : fs::directory_iterator(source_path)) {
+                string extension = entry.path().extension().string();
+                if (!entry.is_regular_file() || (extension != ".csv" && extension != ".fsx")) continue;
+                BatchJob job;
+                job.symbol = entry.path().stem().string();
+                job.path = entry.path().string();
+                jobs.push_back(job);
+            }
+            sort(jobs.begin(), jobs.end(), [](const BatchJob& a, const BatchJob& b) {
+                return a.symbol < b.symbol;
+            });
+            return jobs;
+        }
+        
+        ifstream manifest(source.c_str());
+        if (!manifest.is_open()) {
+            throw runtime_error("Cannot open batch source: " + source);
+        }
+        
+        fs::path base = source_path.parent_path();
+        string line;
+        while (getline(manifest, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
+            
+            BatchJob job;
+            size_t comma = line.find(',');
+            if (comma == string::npos) {
+                job.path = line;
+                job.symbol = fs::path(line).stem().string();
+            } else {
+                job.symbol = line.substr(0, comma);
+                job.path = line.substr(comma + 1);
+            }
+            if (fs::path(job.path).is_relative()) {
+                job.path = (base / job.path).string();
+            }
+            jobs.push_back(job);
+        }
+        return jobs;
+    }
+    
+    static BatchResult runSymbol(const BatchJob& job, double initial_cash,
+                                 const StrategyParams& params = StrategyParams(),
+                                 bool keep_fills = false, const string& cache_dir = "") {
+        BatchResult result;
+        result.symbol = job.symbol;
+        try {
+            // One engine and buffer per worker, reused across its symbols
+            static thread_local IndicatorEngine engine;
+            static thread_local IndicatorSet indicators;
+            CachedPrices cached;
+            unique_ptr<PriceSource> source;
+            PriceView price_data;
+            if (!cache_dir.empty() && !BinaryPriceFile::isBinaryPath(job.path)) {
+                cached = IndicatorCache::load(job.path, cache_dir, job.symbol);
+                price_data = cached.series.view();
+                indicators = std::move(cached.indicators);
+            } else {
+                source.reset(new PriceSource(job.path));
+                price_data = source->view();
+                engine.compute(price_data, indicators);
+            }
+            result.bars = price_data.size();
+            
+            AdvancedTradingStrategy strategy(initial_cash, params);
+            strategy.setVerbose(false);
+            strategy.backtest(price_data, indicators);
+            result.metrics = strategy.calculatePerformanceMetrics(price_data);
+            if (keep_fills) result.fills = strategy.getTradeLog().fills();
+        } catch (const exception& e) {
+            result.error = e.what();
+        }
+        return result;
+    }
+    
+    // Rows (and the fills of trade logs in outputs) go through a ResultSink,
+    // so workers never wait on each other's output. In deterministic mode
+    // everything is written in job order once every symbol has finished;
+    // otherwise each run is written as soon as it completes. With a
+    // cache_dir, CSV symbols load through IndicatorCache.
+    static vector<BatchResult> run(const vector<BatchJob>& jobs, ostream& out,
+                                   size_t threads = 0, bool deterministic = false,
+                                   double initial_cash = 100000.0,
+                                   const StrategyParams& params = StrategyParams(),
+                                   const ResultSinkConfig& outputs = ResultSinkConfig(),
+                                   const string& cache_dir = "") {
+        vector<BatchResult> results(jobs.size());
+        writeHeader(out);
+        
+        vector<string> symbols;
+        for (const auto& job : jobs) symbols.push_back(job.symbol);
+        ResultSinkConfig config = outputs;
+        config.runs = &out;
+        config.run_writer = &BatchRunner::writeRow;
+        
+        ThreadPool pool(threads);
+        ResultSink sink(pool.size() + 1, symbols, config);
+        bool keep_fills = sink.writesTrades();
+        
+        pool.parallelFor(jobs.size(), [&](size_t i) {
+            results[i] = runSymbol(jobs[i], initial_cash, params, keep_fills, cache_dir);
+            if (!deterministic) push(sink, ThreadPool::workerIndex(), i, results[i]);
+        });
+        
+        if (deterministic) {
+            // The calling thread owns the last producer slot
+            for (size_t i = 0; i < results.size(); ++i) push(sink, pool.size(), i, results[i]);
+        }
+        sink.close();
+        return results;
+    }
+    
+    static void push(ResultSink& sink, size_t producer, size_t run, const BatchResult& result) {
+        for (const auto& fill : result.fills) sink.pushFill(producer, (uint32_t)run, fill);
+        sink.pushRun(producer, (uint32_t)run, result);
+    }
+    
+    static void writeHeader(ostream& out) {
+        out << "symbol,bars,final_value,total_return,buy_hold_return,alpha,sharpe,"
+            << "max_drawdown,buy_trades,sell_trades,win_rate,status" << "\n";
+    }
+    
+    static void writeRow(ostream& out, const BatchResult& result) {
+        const PerformanceMetrics& m = result.metrics;
+        string status = result.error.empty() ? "ok" : "error: " + result.error;
+        replace(status.begin(), status.end(), ',', ';');
+        ostringstream row;
+        row << fixed << setprecision(6);
+        row << result.symbol << "," << result.bars << ","
+            << m.final_value << "," << m.total_return << "," << m.buy_hold_return << ","
+            << m.alpha() << "," << m.sharpe << "," << m.max_drawdown << ","
+            << m.buy_trades << "," << m.sell_trades << "," << m.win_rate << ","
+            << status << "\n";
+        out << row.str();
+    }
+};
+
+struct SweepDimension {
+    string name;
+    vector<double> values;
+};
+
+struct SweepResult {
+    StrategyParams params;
+    PerformanceMetrics metrics;
+};
+
+// Grid / random-sample search over StrategyParams. Indicators are computed
+// once per symbol and shared read-only by every trial.
+// Parses a whole command-line or grid token as a number; surrounding spaces
+// are allowed, anything else left over is not.
+template <typename T>
+static inline bool parseNumber(const string& text, T& value) {
+    size_t first = text.find_first_not_of(" \t");
+    size_t last = text.find_last_not_of(" \t");
+    if (first == string::npos) return false;
+    const char* begin = text.data() + first;
+    const char* end = text.data() + last + 1;
+    if (*begin == '+') ++begin;
+    auto result = from_chars(begin, end, value);
+    return result.ec == errc() && result.ptr == end;
+}
+
+class ParameterSweep {
+public:
+    // Parses "name=v1,v2,v3;name=start:stop:step" into sweep dimensions.
+    static vector<SweepDimension> parseGrid(const string& spec) {
+        vector<SweepDimension> dims;
+        stringstream specs(spec);
+        string item;
+        
+        while (getline(specs, item, ';')) {
+            if (item.empty()) continue;
+            size_t eq = item.find('=');
+            if (eq == string::npos) {
+                throw runtime_error("Invalid grid entry (expected name=values): " + item);
+            }
+            
+            SweepDimension dim;
+            dim.name = item.substr(0, eq);
+            string values = item.substr(eq + 1);
+            
+            StrategyParams probe;
+            if (!probe.set(dim.name, 0.0)) {
+                throw runtime_error("Unknown strategy parameter: " + dim.name);
+            }
+            
+            if (values.find(':') != string::npos) {
+                vector<double> range;
+                stringstream parts(values);
+                string part;
+                while (getline(parts, part, ':')) range.push_back(parseValue(part, item));
+                if (range.size() != 3 || range[2] <= 0) {
+                    throw runtime_error("Invalid grid range: " + item);
+                }
+                double start = range[0], stop = range[1], step = range[2];
+                if ((stop - start) / step + 1 > (double)MAX_TRIALS) {
+                    throw runtime_error("Parameter grid too large; use --samples instead");
+                }
+                // Index-based so rounding never drops the last value
+                int count = (int)floor((stop - start) / step + 1e-9) + 1;
+                for (int i = 0; i < count; ++i) {
+                    dim.values.push_back(start + i * step);
+                }
+            } else {
+                stringstream list(values);
+                string value;
+                while (getline(list, value, ',')) {
+                    if (!value.empty()) dim.values.push_back(parseValue(value, item));
+                }
+            }
+            
+            if (dim.values.empty()) {
+                throw runtime_error("Grid dimension has no values: " + item);
+            }
+            dims.push_back(dim);
+        }
+        return dims;
+    }
+    
+    static double parseValue(const string& token, const string& item) {
+        double value = 0.0;
+        if (!parseNumber(token, value)) {
+            throw runtime_error("Invalid grid value '" + token + "' in: " + item);
+        }
+        return value;
+    }
+    
+    static vector<SweepDimension> defaultGrid() {
+        return parseGrid("rsi_oversold=20:35:5;rsi_overbought=65:80:5;"
+                         "stop_loss_pct=0.04:0.10:0.02;take_profit_pct=0.08:0.20:0.04;"
+                         "position_size_pct=0.5,0.9;max_consecutive_losses=2,3,5");
+    }
+    
+    static vector<StrategyParams> expandGrid(const vector<SweepDimension>& dims,
+                                             const StrategyParams& base = StrategyParams()) {
+        size_t total = 1;
+        for (const auto& dim : dims) {
+            total *= dim.values.size();
+            if (total > MAX_TRIALS) {
+                throw runtime_error("Parameter grid too large; use --samples instead");
+            }
+        }
+        
+        vector<StrategyParams> trials;
+        trials.reserve(total);
+        for (size_t t = 0; t < total; ++t) {
+            StrategyParams params = base;
+            size_t index = t;
+            for (const auto& dim : dims) {
+                params.set(dim.name, dim.values[index % dim.values.size()]);
+                index /= dim.values.size();
+            }
+            trials.push_back(params);
+        }
+        return trials;
+    }
+    
+    // Draws each knob uniformly between the smallest and largest value of its
+    // grid dimension. The sample depends only on the seed.
+    static vector<StrategyParams> sampleRandom(const vector<SweepDimension>& dims, size_t count,
+                                               uint64_t seed, const StrategyParams& base = StrategyParams()) {
+        if (count > MAX_TRIALS) {
+            throw runtime_error("Too many samples (at most " + to_string(MAX_TRIALS) + ")");
+        }
+        mt19937_64 rng(seed);
+        vector<StrategyParams> trials;
+        trials.reserve(count);
+        for (size_t t = 0; t < count; ++t) {
+            StrategyParams params = base;
+            for (const auto& dim : dims) {
+                auto range = minmax_element(dim.values.begin(), dim.values.end());
+                uniform_real_distribution<double> dist(*range.first, *range.second);
+                params.set(dim.name, dist(rng));
+            }
+            trials.push_back(params);
+        }
+        return trials;
+    }
+    
+    static vector<SweepResult> run(const PriceView& price_data, const IndicatorSet& indicators,
+                                   const vector<StrategyParams>& trials, size_t threads = 0,
+                                   double initial_cash = 100000.0) {
+        vector<SweepResult> results(trials.size());
+        vector<SignalMasks> masks = buildMasks(indicators, trials);
+        ThreadPool pool(threads);
+        
+        // Batch trials per task so scheduling overhead stays negligible
+        const size_t chunk = 64;
+        size_t chunks = (trials.size() + chunk - 1) / chunk;
+        pool.parallelFor(chunks, [&](size_t c) {
+            size_t end = min(trials.size(), (c + 1) * chunk);
+            // One strategy per worker; only its running metrics are needed
+            static thread_local AdvancedTradingStrategy strategy;
+            strategy.setVerbose(false);
+            strategy.setRecordHistory(false);
+            for (size_t t = c * chunk; t < end; ++t) {
+                strategy.reset(initial_cash, trials[t]);
+                strategy.backtest(price_data, indicators, 0, price_data.size(), masks[trials[t].rule_set]);
+                results[t].params = trials[t];
+                results[t].metrics = strategy.calculatePerformanceMetrics(price_data);
+            }
+        });
+        return results;
+    }
+    
+    // Signal masks covering every trial, indexed by rule set. Sets no trial
+    // uses are left empty.
+    static vector<SignalMasks> buildMasks(const IndicatorSet& indicators, const vector<StrategyParams>& trials) {
+        vector<bool> used(StrategyCatalog::COUNT, false);
+        for (const auto& trial : trials) {
+            if (trial.rule_set < 0 || trial.rule_set >= StrategyCatalog::COUNT) {
+                throw runtime_error("Unknown rule set: " + to_string(trial.rule_set));
+            }
+            used[trial.rule_set] = true;
+        }
+        
+        vector<SignalMasks> masks(StrategyCatalog::COUNT);
+        for (int id = 0; id < StrategyCatalog::COUNT; ++id) {
+            if (used[id]) masks[id] = SignalMasks::build(indicators, trials, id);
+        }
+        return masks;
+    }
+    
+    static void writeResults(ostream& out, const vector<SweepResult>& results) {
+        out << "trial,rsi_oversold,rsi_overbought,stop_loss_pct,take_profit_pct,position_size_pct,"
+            << "max_consecutive_losses,final_value,total_return,sharpe,max_drawdown,buy_trades,win_rate" << "\n";
+        out << fixed << setprecision(6);
+        for (size_t t = 0; t < results.size(); ++t) {
+            const StrategyParams& p = results[t].params;
+            const PerformanceMetrics& m = results[t].metrics;
+            out << t << "," << p.rsi_oversold << "," << p.rsi_overbought << ","
+                << p.stop_loss_pct << "," << p.take_profit_pct << "," << p.position_size_pct << ","
+                << p.max_consecutive_losses << "," << m.final_value << "," << m.total_return << ","
+                << m.sharpe << "," << m.max_drawdown << "," << m.buy_trades << "," << m.win_rate << "\n";
+        }
+    }
+    
+    // Each trial keeps its parameters and a result row (about 270 bytes), so
+    // this bounds a sweep to a few hundred MB
+    static const size_t MAX_TRIALS = 1000000;
+};
+
+struct WalkForwardWindow {
+    size_t train_begin = 0;          // In-sample bars [train_begin, train_end)
+    size_t train_end = 0;
+    size_t test_begin = 0;           // Out-of-sample bars [test_begin, test_end)
+    size_t test_end = 0;
+    StrategyParams params;           // Best in-sample parameter set
+    PerformanceMetrics in_sample;
+    PerformanceMetrics out_of_sample;
+};
+
+struct WalkForwardResult {
+    double initial_capital = 0.0;
+    vector<WalkForwardWindow> windows;
+    vector<uint32_t> bars;           // Stitched out-of-sample equity curve
+    vector<double> equity;
+    MetricsAccumulator combined;     // Metrics of the stitched curve
+    
+    double finalValue() const { return equity.empty() ? initial_capital : equity.back(); }
+    double totalReturn() const {
+        return initial_capital > 0 ? (finalValue() - initial_capital) / initial_capital : 0.0;
+    }
+};
+
+// Walk-forward analysis: picks the best trial by Sharpe ratio on each
+// training window and trades it on the following test window. All windows
+// share one precomputed IndicatorSet, so no window re-computes or re-warms
+// indicators.
+class WalkForward {
+public:
+    // Rolling windows of train_bars followed by test_bars, advanced by
+    // test_bars. Anchored windows keep bar 0 as the training start instead.
+    static vector<WalkForwardWindow> makeWindows(size_t total_bars, size_t train_bars,
+                                                 size_t test_bars, bool anchored = false) {
+        if (train_bars == 0 || test_bars == 0) {
+            throw runtime_error("Walk-forward windows must be non-empty");
+        }
+        
+        vector<WalkForwardWindow> windows;
+        for (size_t test_begin = train_bars; test_begin < total_bars; test_begin += test_bars) {
+            WalkForwardWindow window;
+            window.train_begin = anchored ? 0 : test_begin - train_bars;
+            window.train_end = test_begin;
+            window.test_begin = test_begin;
+            window.test_end = min(total_bars, test_begin + test_bars);
+            windows.push_back(window);
+        }
+        return windows;
+    }
+    
+    // Optimizes every training window in parallel, then runs every test
+    // window in parallel. Each test window starts flat; the stitched curve
+    // chains them by scaling each window's equity to the previous window's
+    // closing value (an open position is marked to market at the boundary).
+    static WalkForwardResult run(const PriceView& price_data, const IndicatorSet& indicators,
+                                 const vector<StrategyParams>& trials, vector<WalkForwardWindow> windows,
+                                 size_t threads = 0, double initial_cash = 100000.0) {
+        if (trials.empty()) {
+            throw runtime_error("Walk-forward needs at least one parameter set");
+        }
+        if (windows.empty()) {
+            throw runtime_error("Not enough data for one walk-forward window");
+        }
+        
+        ThreadPool pool(threads);
+        
+        // In-sample search, one task per (window, chunk of trials)
+        const size_t chunk = 64;
+        size_t chunks = (trials.size() + chunk - 1) / chunk;
+        vector<double> scores(windows.size() * trials.size());
+        vector<SignalMasks> masks = ParameterSweep::buildMasks(indicators, trials);
+        pool.parallelFor(windows.size() * chunks, [&](size_t task) {
+            const WalkForwardWindow& window = windows[task / chunks];
+            size_t c = task % chunks;
+            size_t end = min(trials.size(), (c + 1) * chunk);
+            static thread_local AdvancedTradingStrategy strategy;
+            strategy.setVerbose(false);
+            strategy.setRecordHistory(false);
+            for (size_t t = c * chunk; t < end; ++t) {
+                strategy.reset(initial_cash, trials[t]);
+                strategy.backtest(price_data, indicators, window.train_begin, window.train_end,
+                                  masks[trials[t].rule_set]);
+                scores[(task / chunks) * trials.size() + t] =
+                    strategy.calculatePerformanceMetrics(price_data, window.train_begin, window.train_end).sharpe;
+            }
+        });
+        
+        // Out-of-sample run with each window's winner
+        vector<vector<double>> curves(windows.size());
+        vector<MetricsAccumulator> window_metrics(windows.size());
+        pool.parallelFor(windows.size(), [&](size_t w) {
+            WalkForwardWindow& window = windows[w];
+            const double* score = &scores[w * trials.size()];
+            size_t best = 0;
+            for (size_t t = 1; t < trials.size(); ++t) {
+                if (score[t] > score[best]) best = t;
+            }
+            window.params = trials[best];
+            
+            static thread_local AdvancedTradingStrategy strategy;
+            strategy.setVerbose(false);
+            strategy.reset(initial_cash, window.params);
+            strategy.backtest(price_data, indicators, window.train_begin, window.train_end);
+            window.in_sample = strategy.calculatePerformanceMetrics(price_data, window.train_begin, window.train_end);
+            
+            strategy.reset(initial_cash, window.params);
+            strategy.backtest(price_data, indicators, window.test_begin, window.test_end);
+            window.out_of_sample = strategy.calculatePerformanceMetrics(price_data, window.test_begin, window.test_end);
+            curves[w] = strategy.getTradeLog().equity();
+            window_metrics[w] = strategy.getMetrics();
+        });
+        
+        WalkForwardResult result;
+        result.initial_capital = initial_cash;
+        result.windows = windows;
+        double carry = initial_cash;
+        for (size_t w = 0; w < windows.size(); ++w) {
+            const vector<double>& curve = curves[w];
+            size_t first = windows[w].test_end - curve.size();
+            double scale = carry / initial_cash;
+            for (size_t i = 0; i < curve.size(); ++i) {
+                result.bars.push_back((uint32_t)(first + i));
+                result.equity.push_back(curve[i] * scale);
+            }
+            if (!curve.empty()) carry = result.equity.back();
+            result.combined.merge(window_metrics[w]);
+        }
+        return result;
+    }
+    
+    static void writeEquity(ostream& out, const PriceView& price_data, const WalkForwardResult& result) {
+        out << "bar,date,equity" << "\n";
+        out << fixed << setprecision(2);
+        for (size_t i = 0; i < result.bars.size(); ++i) {
+            out << result.bars[i] << "," << Timestamp::format(price_data.timestamp[result.bars[i]]) << "," << result.equity[i] << "\n";
+        }
+    }
+};
+
+// Position sizing and risk limits for PortfolioEngine, as fractions of the
+// current portfolio value.
+struct PortfolioLimits {
+    double position_pct = 0.05;      // Size of each new position
+    double max_exposure_pct = 1.0;   // Cap on total long market value
+    size_t max_positions = 0;        // Open positions allowed at once (0 = no limit)
+};
+
+struct PortfolioFill {
+    int64_t timestamp;
+    uint32_t symbol;                 // Index into the engine's symbol list
+    TradeAction action;
+    uint16_t reason;
+    double price;
+    double shares;
+};
+
+struct PortfolioResult {
+    double initial_capital = 0.0;
+    double final_value = 0.0;
+    double cash = 0.0;
+    double max_drawdown = 0.0;
+    double peak_exposure = 0.0;      // Largest market value / portfolio value seen
+    size_t bars = 0;                 // Symbol bars processed
+    size_t open_positions = 0;
+    size_t skipped_buys = 0;         // Buy signals rejected for cash or limits
+    int buy_trades = 0;
+    int sell_trades = 0;
+    int winning_trades = 0;
+    vector<int64_t> timestamps;      // Equity curve, one point per distinct timestamp
+    vector<double> equity;
+    vector<PortfolioFill> fills;
+    
+    double totalReturn() const {
+        return initial_capital > 0 ? (final_value - initial_capital) / initial_capital : 0.0;
+    }
+};
+
+// Trades many symbols against one cash account. The per-symbol bar streams
+// are merged by timestamp with a k-way heap; each symbol keeps its own
+// streaming indicators and runs the same SignalRules as
+// AdvancedTradingStrategy. Fills are settled once per timestamp: exits
+// first, then entries in symbol order, each sized from the portfolio value
+// and checked against the limits.
+class PortfolioEngine {
+public:
+    static PortfolioResult run(const vector<PriceView>& symbols, const StrategyParams& params = StrategyParams(),
+                               const PortfolioLimits& limits = PortfolioLimits(),
+                               double initial_cash = 100000.0) {
+        PortfolioResult result;
+        StrategyCatalog::dispatch(params.rule_set, [&](auto rules) {
+            result = simulate<decltype(rules)>(symbols, params, limits, initial_cash);
+        });
+        return result;
+    }
+    
+private:
+    template <typename Set>
+    static PortfolioResult simulate(const vector<PriceView>& symbols, const StrategyParams& params,
+                                    const PortfolioLimits& limits, double initial_cash) {
+        Profiler::Scope scope("portfolio");
+        PortfolioResult result;
+        result.initial_capital = initial_cash;
+        
+        vector<SymbolState> states(symbols.size());
+        vector<Cursor> heap;
+        heap.reserve(symbols.size());
+        for (size_t s = 0; s < symbols.size(); ++s) {
+            if (symbols[s].size() > 0) {
+                heap.push_back(Cursor{symbols[s].timestamp[0], (uint32_t)s, 0});
+            }
+        }
+        make_heap(heap.begin(), heap.end(), later);
+        
+        double cash = initial_cash;
+        double market_value = 0.0;
+        double peak = initial_cash;
+        size_t open_positions = 0;
+        vector<Order> orders;
+        
+        while (!heap.empty()) {
+            int64_t now = heap.front().timestamp;
+            orders.clear();
+            
+            // Advance every symbol with a bar at this timestamp
+            while (!heap.empty() && heap.front().timestamp == now) {
+                pop_heap(heap.begin(), heap.end(), later);
+                Cursor cursor = heap.back();
+                heap.pop_back();
+                
+                const PriceView& view = symbols[cursor.symbol];
+                SymbolState& state = states[cursor.symbol];
+                double price = view.close[cursor.row];
+                IndicatorSnapshot current = state.indicators.update(price);
+                market_value += state.shares * (price - state.last_price);
+                state.last_price = price;
+                
+                if (state.bars++ >= AdvancedTradingStrategy::WARMUP_BARS) {
+                    uint16_t reason = REASON_NO_SIGNAL;
+                    TradeAction action = SignalRules::evaluate<Set>(params, state.shares, state.entry_price,
+                                                               state.consecutive_losses, true,
+                                                               current, state.prev, reason);
+                    if (action != TradeAction::Hold) {
+                        orders.push_back(Order{cursor.symbol, action, reason});
+                    }
+                }
+                state.prev = current;
+                result.bars++;
+                
+                if (++cursor.row < view.size()) {
+                    cursor.timestamp = view.timestamp[cursor.row];
+                    heap.push_back(cursor);
+                    push_heap(heap.begin(), heap.end(), later);
+                }
+            }
+            
+            // Exits free cash for this timestamp's entries
+            for (const Order& order : orders) {
+                if (order.action != TradeAction::Sell) continue;
+                SymbolState& state = states[order.symbol];
+                double proceeds = state.shares * state.last_price;
+                if (state.last_price > state.entry_price) result.winning_trades++;
+                result.fills.push_back(PortfolioFill{now, order.symbol, TradeAction::Sell, order.reason,
+                                                     state.last_price, state.shares});
+                cash += proceeds;
+                market_value -= proceeds;
+                state.shares = 0.0;
+                state.entry_price = 0.0;
+                open_positions--;
+                result.sell_trades++;
+            }
+            
+            double equity = cash + market_value;
+            for (const Order& order : orders) {
+                if (order.action != TradeAction::Buy) continue;
+                SymbolState& state = states[order.symbol];
+                double budget = min(cash, min(equity * limits.position_pct,
+                                              equity * limits.max_exposure_pct - market_value));
+                bool position_slot = limits.max_positions == 0 || open_positions < limits.max_positions;
+                if (!position_slot || budget <= state.last_price) {
+                    result.skipped_buys++;
+                    continue;
+                }
+                state.shares = budget / state.last_price;
+                state.entry_price = state.last_price;
+                cash -= state.shares * state.last_price;
+                market_value += state.shares * state.last_price;
+                open_positions++;
+                result.buy_trades++;
+                result.fills.push_back(PortfolioFill{now, order.symbol, TradeAction::Buy, order.reason,
+                                                     state.last_price, state.shares});
+            }
+            
+            equity = cash + market_value;
+            result.timestamps.push_back(now);
+            result.equity.push_back(equity);
+            peak = max(peak, equity);
+            if (peak > 0) result.max_drawdown = max(result.max_drawdown, (peak - equity) / peak);
+            if (equity > 0) result.peak_exposure = max(result.peak_exposure, market_value / equity);
+        }
+        
+        // Re-mark open positions exactly rather than trusting the running sum
+        market_value = 0.0;
+        for (const SymbolState& state : states) {
+            market_value += state.shares * state.last_price;
+        }
+        result.cash = cash;
+        result.final_value = cash + market_value;
+        result.open_positions = open_positions;
+        if (!result.equity.empty()) result.equity.back() = result.final_value;
+        scope.setBars(result.bars);
+        return result;
+    }
+    
+    struct SymbolState {
+        StreamingIndicators indicators;
+        IndicatorSnapshot prev;
+        size_t bars = 0;
+        double shares = 0.0;
+        double entry_price = 0.0;
+        double last_price = 0.0;
+        int consecutive_losses = 0;
+    };
+    
+    // Next unread bar of one symbol
+    struct Cursor {
+        int64_t timestamp;
+        uint32_t symbol;
+        uint32_t row;
+    };
+    
+    struct Order {
+        uint32_t symbol;
+        TradeAction action;
+        uint16_t reason;
+    };
+    
+    // Heap order: earliest timestamp on top, ties broken by symbol index
+    static bool later(const Cursor& a, const Cursor& b) {
+        return a.timestamp != b.timestamp ? a.timestamp > b.timestamp : a.symbol > b.symbol;
+    }
+};
+
+// Counter-based generator: output n of stream (seed, stream) is a pure hash of
+// those three values, so every Monte Carlo path draws the same numbers no
+// matter which thread runs it or in what order.
+class CounterRng {
+public:
+    CounterRng(uint64_t seed, uint64_t stream) : key(mix(seed ^ mix(stream + 0x632be59bd9b4e019ULL))), counter(0) {}
+    
+    uint64_t next() { return mix(key + 0x9e3779b97f4a7c15ULL * ++counter); }
+    
+    // Uniform in [0, 1)
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+    
+    // Standard normal (Box-Muller)
+    double normal() {
+        if (has_spare) {
+            has_spare = false;
+            return spare;
+        }
+        double u1 = 1.0 - uniform();  // (0, 1]
+        double u2 = uniform();
+        double radius = sqrt(-2.0 * log(u1));
+        spare = radius * sin(TWO_PI * u2);
+        has_spare = true;
+        return radius * cos(TWO_PI * u2);
+    }
+    
+    size_t below(size_t bound) { return (size_t)(uniform() * bound); }
+    
+private:
+    static constexpr double TWO_PI = 6.283185307179586;
+    
+    // SplitMix64 finalizer
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+    
+    uint64_t key;
+    uint64_t counter;
+    double spare = 0.0;
+    bool has_spare = false;
+};
+
+enum class PathModel { Bootstrap, GBM };
+
+struct MonteCarloConfig {
+    PathModel model = PathModel::Bootstrap;
+    size_t paths = 1000;
+    size_t bars = 0;                 // Bars per path (0 = length of the source)
+    size_t block = 10;               // Bootstrap block length in bars
+    uint64_t seed = 42;
+    size_t threads = 0;
+    double initial_cash = 100000.0;
+    StrategyParams params;
+};
+
+struct Percentiles {
+    double mean = 0.0;
+    double p05 = 0.0, p25 = 0.0, p50 = 0.0, p75 = 0.0, p95 = 0.0;
+};
+
+struct MonteCarloResult {
+    vector<PerformanceMetrics> paths;  // Metrics of each path, in path order
+    Percentiles sharpe;
+    Percentiles max_drawdown;
+    Percentiles total_return;
+    Percentiles alpha;
+};
+
+// Robustness check: runs the full indicator + backtest pipeline on many
+// synthetic price paths derived from one series and summarizes the spread of
+// the resulting metrics. Paths either resample blocks of the series' log
+// returns (keeping short-range autocorrelation) or follow a geometric
+// Brownian motion with the series' drift and volatility.
+class MonteCarlo {
+public:
+    static MonteCarloResult run(const PriceView& source, const MonteCarloConfig& config) {
+        if (source.size() < AdvancedTradingStrategy::WARMUP_BARS) {
+            throw runtime_error("Insufficient data for backtesting");
+        }
+        size_t bars = config.bars > 0 ? config.bars : source.size();
+        if (bars < AdvancedTradingStrategy::WARMUP_BARS) {
+            throw runtime_error("Monte Carlo paths must have at least 50 bars");
+        }
+        
+        vector<double> returns;
+        returns.reserve(source.size() - 1);
+        for (size_t i = 1; i < source.size(); ++i) {
+            returns.push_back(log(source.close[i] / source.close[i - 1]));
+        }
+        size_t block = max<size_t>(1, min(config.block, returns.size()));
+        
+        double drift = 0.0, volatility = 0.0;
+        for (double r : returns) drift += r;
+        drift /= returns.size();
+        for (double r : returns) volatility += (r - drift) * (r - drift);
+        volatility = sqrt(volatility / returns.size());
+        
+        MonteCarloResult result;
+        result.paths.resize(config.paths);
+        
+        const size_t chunk = 16;
+        size_t chunks = (config.paths + chunk - 1) / chunk;
+        ThreadPool pool(config.threads);
+        pool.parallelFor(chunks, [&](size_t c) {
+            // Path buffer, indicators and strategy are reused across a worker's paths
+            static thread_local vector<PriceData> path;
+            static thread_local IndicatorEngine engine;
+            static thread_local IndicatorSet indicators;
+            static thread_local AdvancedTradingStrategy strategy;
+            strategy.setVerbose(false);
+            strategy.setRecordHistory(false);
+            path.resize(bars);
+            
+            size_t end = min(config.paths, (c + 1) * chunk);
+            for (size_t p = c * chunk; p < end; ++p) {
+                CounterRng rng(config.seed, p);
+                double price = source.close[0];
+                size_t offset = block;
+                size_t start = 0;
+                for (size_t i = 0; i < bars; ++i) {
+                    double open = price;
+                    if (i > 0) {
+                        double r;
+                        if (config.model == PathModel::GBM) {
+                            r = drift + volatility * rng.normal();
+                        } else {
+                            if (offset == block) {
+                                start = rng.below(returns.size() - block + 1);
+                                offset = 0;
+                            }
+                            r = returns[start + offset++];
+                        }
+                        price *= exp(r);
+                    }
+                    PriceData& bar = path[i];
+                    bar.timestamp = source.timestamp[0] + (int64_t)i * Timestamp::SECONDS_PER_DAY;
+                    bar.open = open;
+                    bar.high = max(open, price);
+                    bar.low = min(open, price);
+                    bar.close = price;
+                    bar.volume = 0.0;
+                }
+                
+                engine.compute(path, indicators);
+                strategy.reset(config.initial_cash, config.params);
+                strategy.backtest(path, indicators);
+                result.paths[p] = strategy.calculatePerformanceMetrics(path);
+            }
+        });
+        
+        vector<double> values(config.paths);
+        auto summarize = [&](double (*metric)(const PerformanceMetrics&)) {
+            for (size_t p = 0; p < config.paths; ++p) values[p] = metric(result.paths[p]);
+            return percentiles(values);
+        };
+        result.sharpe = summarize([](const PerformanceMetrics& m) { return m.sharpe; });
+        result.max_drawdown = summarize([](const PerformanceMetrics& m) { return m.max_drawdown; });
+        result.total_return = summarize([](const PerformanceMetrics& m) { return m.total_return; });
+        result.alpha = summarize([](const PerformanceMetrics& m) { return m.alpha(); });
+        return result;
+    }
+    
+    // Linear-interpolated percentiles; sorts values in place.
+    static Percentiles percentiles(vector<double>& values) {
+        Percentiles p;
+        if (values.empty()) return p;
+        sort(values.begin(), values.end());
+        for (double v : values) p.mean += v;
+        p.mean /= values.size();
+        auto at = [&](double q) {
+            double pos = q * (values.size() - 1);
+            size_t lo = (size_t)pos;
+            size_t hi = min(lo + 1, values.size() - 1);
+            return values[lo] + (values[hi] - values[lo]) * (pos - lo);
+        };
+        p.p05 = at(0.05);
+        p.p25 = at(0.25);
+        p.p50 = at(0.50);
+        p.p75 = at(0.75);
+        p.p95 = at(0.95);
+        return p;
+    }
+    
+    static void writePaths(ostream& out, const MonteCarloResult& result) {
+        out << "path,final_value,total_return,buy_hold_return,sharpe,max_drawdown,buy_trades,win_rate" << "\n";
+        out << fixed << setprecision(6);
+        for (size_t p = 0; p < result.paths.size(); ++p) {
+            const PerformanceMetrics& m = result.paths[p];
+            out << p << "," << m.final_value << "," << m.total_return << "," << m.buy_hold_return << ","
+                << m.sharpe << "," << m.max_drawdown << "," << m.buy_trades << "," << m.win_rate << "\n";
+        }
+    }
+};
+
+enum class OrderType : uint8_t { Market, Limit, Stop };
+
+inline const char* orderTypeName(OrderType type) {
+    switch (type) {
+        case OrderType::Market: return "MARKET";
+        case OrderType::Limit: return "LIMIT";
+        case OrderType::Stop: return "STOP";
+    }
+    return "UNKNOWN";
+}
+
+// Commission per fill: a fixed fee plus per-share and basis-point charges,
+// but never less than minimum.
+struct CommissionModel {
+    double per_order = 0.0;
+    double per_share = 0.0;
+    double bps = 0.0;                // Of traded notional
+    double minimum = 0.0;
+    
+    double cost(double price, double shares) const {
+        return max(minimum, per_order + per_share * shares + bps * 1e-4 * price * shares);
+    }
+    
+    // Most shares that cash buys at price with this commission included.
+    // The total is the larger of the minimum-fee and the linear-fee cost, so
+    // the answer is the smaller of the two quantities.
+    double affordableShares(double price, double cash) const {
+        double at_minimum = (cash - minimum) / price;
+        double at_linear = (cash - per_order) / (price + per_share + bps * 1e-4 * price);
+        return min(at_minimum, at_linear);
+    }
+};
+
+// Slippage on market and stop fills: the price moves against the order by
+// bps basis points plus range_fraction of the bar's high - low, but never
+// outside the bar. Limit orders fill at their limit or better.
+struct SlippageModel {
+    double bps = 0.0;
+    double range_fraction = 0.0;
+    
+    double apply(double price, TradeAction side, double high, double low) const {
+        double slip = price * bps * 1e-4 + (high - low) * range_fraction;
+        return side == TradeAction::Buy ? min(high, price + slip) : max(low, price - slip);
+    }
+};
+
+struct ExecutionConfig {
+    OrderType entry_type = OrderType::Market;
+    double entry_offset_pct = 0.0;   // Limit entries this far below the signal close, stop entries above
+    size_t entry_expiry_bars = 1;    // Unfilled limit / stop entries are cancelled after this many bars
+    size_t latency_bars = 1;         // Bars between a signal and its order going live (at least 1)
+    CommissionModel commission;
+    SlippageModel slippage;
+};
+
+struct ExecutionFill {
+    int64_t timestamp;
+    uint32_t bar;
+    TradeAction action;
+    OrderType type;
+    uint16_t reason;
+    double price;
+    double shares;
+    double commission;
+};
+
+struct ExecutionResult {
+    PerformanceMetrics metrics;
+    vector<ExecutionFill> fills;
+    double commission_paid = 0.0;
+    double slippage_paid = 0.0;      // Versus the unslipped trigger price
+    size_t bars = 0;
+    size_t events = 0;
+    size_t expired_orders = 0;
+};
+
+// Event-driven execution of a rule set on OHLC bars. Signals are evaluated at
+// each bar's close and become orders that go live latency_bars later, so a
+// fill never uses the bar that produced its signal. A position is protected
+// by a stop order at the stop loss and a limit order at the take profit,
+// live from the bar after the entry fill; both are matched against each
+// bar's high and low instead of its close.
+//
+// Events (order submissions, entry expiries, bars) run from a priority queue
+// ordered by bar, then kind, then sequence. Within a bar, orders that trigger
+// at the open fill there (gaps fill at the open, not the order price); of
+// orders triggered inside the bar, stops fill before limits, since the path
+// between high and low is unknown and the adverse fill is the conservative
+// one.
+class ExecutionEngine {
+public:
+    static ExecutionResult run(const PriceView& bars, const IndicatorSet& indicators,
+                               const StrategyParams& params = StrategyParams(),
+                               const ExecutionConfig& config = ExecutionConfig(),
+                               double initial_cash = 100000.0) {
+        if (bars.size() < AdvancedTradingStrategy::WARMUP_BARS) {
+            throw runtime_error("Insufficient data for backtesting");
+        }
+        if (indicators.size() != bars.size()) {
+            throw runtime_error("Indicator set does not match price data");
+        }
+        
+        ExecutionResult result;
+        StrategyCatalog::dispatch(params.rule_set, [&](auto rules) {
+            ExecutionEngine engine(bars, indicators, params, config, initial_cash);
+            engine.simulate<decltype(rules)>(result);
+        });
+        return result;
+    }
+    
+private:
+    enum EventKind : uint8_t { EXPIRE, SUBMIT, BAR };   // Order within one bar
+    
+    struct Order {
+        uint32_t id;
+        OrderType type;
+        TradeAction action;
+        uint16_t reason;
+        double price;                // Limit or stop price
+    };
+    
+    struct Event {
+        uint32_t bar;
+        EventKind kind;
+        uint32_t sequence;
+        Order order;                 // SUBMIT: the order; EXPIRE: its id
+    };
+    
+    struct Later {
+        bool operator()(const Event& a, const Event& b) const {
+            if (a.bar != b.bar) return a.bar > b.bar;
+            if (a.kind != b.kind) return a.kind > b.kind;
+            return a.sequence > b.sequence;
+        }
+    };
+    
+    // An order that triggered on the current bar
+    struct Trigger {
+        size_t order;                // Index into live
+        int rank;                    // 0 at the open, 1 stop inside the bar, 2 limit inside the bar
+        double price;
+    };
+    
+    ExecutionEngine(const PriceView& bars, const IndicatorSet& indicators, const StrategyParams& params,
+                    const ExecutionConfig& config, double initial_cash)
+        : bars(bars), indicators(indicators), params(params), config(config),
+          cash(initial_cash), initial_capital(initial_cash), metrics(initial_cash) {}
+    
+    template <typename Set>
+    void simulate(ExecutionResult& result) {
+        Profiler::Scope scope("execution", bars.size());
+        const size_t latency = max((size_t)1, config.latency_bars);
+        vector<Trigger> triggers;
+        
+        push(Event{0, BAR, 0, Order()});
+        while (!events.empty()) {
+            Event event = events.top();
+            events.pop();
+            result.events++;
+            
+            if (event.kind == SUBMIT) {
+                // An exit the bracket beat to it, or an entry after a fill
+                bool stale = event.order.action == TradeAction::Sell ? shares == 0 : shares > 0;
+                if (stale) {
+                    abandon(event.order);
+                } else {
+                    live.push_back(event.order);
+                }
+                continue;
+            }
+            if (event.kind == EXPIRE) {
+                if (cancel(event.order.id)) {
+                    entry_pending = false;
+                    result.expired_orders++;
+                }
+                continue;
+            }
+            
+            size_t i = event.bar;
+            double open = bars.open[i], high = bars.high[i], low = bars.low[i], close = bars.close[i];
+            
+            if (protect_from == i) {
+                // Bracket the new position: stop loss and take profit
+                live.push_back(Order{next_id++, OrderType::Stop, TradeAction::Sell, REASON_STOP_LOSS,
+                                     entry_price * (1.0 - params.stop_loss_pct)});
+                live.push_back(Order{next_id++, OrderType::Limit, TradeAction::Sell, REASON_TAKE_PROFIT,
+                                     entry_price * (1.0 + params.take_profit_pct)});
+            }
+            
+            // Match live orders against this bar
+            triggers.clear();
+            for (size_t k = 0; k < live.size(); ++k) {
+                Trigger trigger{k, 0, 0.0};
+                if (triggered(live[k], open, high, low, trigger)) triggers.push_back(trigger);
+            }
+            sort(triggers.begin(), triggers.end(), [&](const Trigger& a, const Trigger& b) {
+                return a.rank != b.rank ? a.rank < b.rank : live[a.order].id < live[b.order].id;
+            });
+            for (const Trigger& trigger : triggers) {
+                Order& order = live[trigger.order];
+                if (order.id == 0) continue;   // Cancelled by an earlier fill this bar
+                bool filled = fill(order, trigger.price, i, high, low, result);
+                if (!filled && order.type == OrderType::Market) {
+                    abandon(order);            // Market orders get one chance
+                }
+                if (filled || order.type == OrderType::Market) order.id = 0;
+            }
+            live.erase(remove_if(live.begin(), live.end(), [](const Order& o) { return o.id == 0; }), live.end());
+            
+            // Like the close-fill backtest, measure from the first tradable bar
+            if (i >= AdvancedTradingStrategy::WARMUP_BARS) {
+                metrics.addBar(cash + shares * close, shares * close);
+            }
+            
+            // Signals at the close become orders for a later bar
+            if (i >= AdvancedTradingStrategy::WARMUP_BARS && i + latency < bars.size()) {
+                IndicatorSnapshot current = indicators.at(i);
+                IndicatorSnapshot prev = indicators.at(i - 1);
+                uint16_t reason = REASON_NO_SIGNAL;
+                if (shares == 0 && !entry_pending && cash > close &&
+                    SignalRules::entrySignal<Set>(params, consecutive_losses, current, prev, reason)) {
+                    submitEntry(i + latency, close, reason);
+                } else if (shares > 0 && !exit_pending &&
+                           SignalRules::exitSignal<Set>(params, current, prev, reason)) {
+                    push(Event{(uint32_t)(i + latency), SUBMIT, next_sequence++,
+                               Order{next_id++, OrderType::Market, TradeAction::Sell, reason, 0.0}});
+                    exit_pending = true;
+                }
+            }
+            
+            result.bars++;
+            if (i + 1 < bars.size()) push(Event{(uint32_t)(i + 1), BAR, next_sequence++, Order()});
+        }
+        
+        double final_price = bars.close[bars.size() - 1];
+        PerformanceMetrics& m = result.metrics;
+        m.has_history = true;
+        m.initial_capital = initial_capital;
+        m.cash = cash;
+        m.shares = shares;
+        m.final_value = cash + shares * final_price;
+        m.total_return = (m.final_value - initial_capital) / initial_capital;
+        m.buy_hold_return = (final_price - bars.close[0]) / bars.close[0];
+        m.unrealized_pnl = shares * (final_price - entry_price);
+        m.buy_trades = metrics.buyTrades();
+        m.sell_trades = metrics.sellTrades();
+        m.win_rate = metrics.winRate();
+        m.sharpe = metrics.sharpe();
+        m.sortino = metrics.sortino();
+        m.max_drawdown = metrics.maxDrawdown();
+        m.max_drawdown_bars = metrics.maxDrawdownBars();
+        m.exposure = metrics.exposure();
+        m.turnover = metrics.turnover();
+    }
+    
+    void submitEntry(size_t bar, double signal_close, uint16_t reason) {
+        Order order{next_id++, config.entry_type, TradeAction::Buy, reason, 0.0};
+        if (order.type == OrderType::Limit) order.price = signal_close * (1.0 - config.entry_offset_pct);
+        if (order.type == OrderType::Stop) order.price = signal_close * (1.0 + config.entry_offset_pct);
+        push(Event{(uint32_t)bar, SUBMIT, next_sequence++, order});
+        if (order.type != OrderType::Market) {
+            size_t expiry = bar + max((size_t)1, config.entry_expiry_bars);
+            if (expiry < bars.size()) push(Event{(uint32_t)expiry, EXPIRE, next_sequence++, order});
+        }
+        entry_pending = true;
+    }
+    
+    // Whether order trades on a bar, and at what price before slippage
+    static bool triggered(const Order& order, double open, double high, double low, Trigger& trigger) {
+        bool buy = order.action == TradeAction::Buy;
+        switch (order.type) {
+            case OrderType::Market:
+                trigger.price = open;
+                return true;
+            case OrderType::Limit:
+                if (buy ? open <= order.price : open >= order.price) {
+                    trigger.price = open;
+                    return true;
+                }
+                trigger.rank = 2;
+                trigger.price = order.price;
+                return buy ? low <= order.price : high >= order.price;
+            case OrderType::Stop:
+                if (buy ? open >= order.price : open <= order.price) {
+                    trigger.price = open;
+                    return true;
+                }
+                trigger.rank = 1;
+                trigger.price = order.price;
+                return buy ? high >= order.price : low <= order.price;
+        }
+        return false;
+    }
+    
+    // Returns false when the position or cash does not allow the trade.
+    bool fill(const Order& order, double trigger_price, size_t bar, double high, double low, ExecutionResult& result) {
+        double price = order.type == OrderType::Limit ? trigger_price
+                                                      : config.slippage.apply(trigger_price, order.action, high, low);
+        if (order.action == TradeAction::Buy) {
+            if (shares > 0) return false;
+            double quantity = cash * params.position_size_pct / price;
+            double commission = config.commission.cost(price, quantity);
+            if (quantity * price + commission > cash) {
+                quantity = config.commission.affordableShares(price, cash);
+                commission = config.commission.cost(price, quantity);
+            }
+            if (!(quantity > 0)) return false;
+            
+            shares = quantity;
+            cash -= quantity * price + commission;
+            entry_price = price;
+            protect_from = bar + 1;
+            entry_pending = false;
+            record(order, price, trigger_price, quantity, commission, bar, result);
+            cancelAll(TradeAction::Buy);
+        } else {
+            if (shares <= 0) return false;
+            double commission = config.commission.cost(price, shares);
+            double quantity = shares;
+            cash += quantity * price - commission;
+            shares = 0.0;
+            if (order.reason == REASON_STOP_LOSS) consecutive_losses++;
+            if (order.reason == REASON_TAKE_PROFIT) consecutive_losses = 0;
+            exit_pending = false;
+            protect_from = SIZE_MAX;
+            record(order, price, trigger_price, quantity, commission, bar, result);
+            cancelAll(TradeAction::Sell);
+        }
+        return true;
+    }
+    
+    // Drops a signal's order that will never trade, so the signal can fire
+    // again. Bracket orders are only ever cancelled by fills.
+    void abandon(const Order& order) {
+        if (order.action == TradeAction::Buy) {
+            entry_pending = false;
+        } else {
+            exit_pending = false;
+        }
+    }
+    
+    void record(const Order& order, double price, double trigger_price, double quantity, double commission,
+                size_t bar, ExecutionResult& result) {
+        metrics.addFill(order.action, price, quantity);
+        result.commission_paid += commission;
+        result.slippage_paid += fabs(price - trigger_price) * quantity;
+        result.fills.push_back(ExecutionFill{bars.timestamp[bar], (uint32_t)bar, order.action, order.type,
+                                             order.reason, price, quantity, commission});
+    }
+    
+    // Marks orders cancelled (id 0); the bar loop drops them.
+    void cancelAll(TradeAction action) {
+        for (Order& order : live) {
+            if (order.action == action) order.id = 0;
+        }
+    }
+    
+    bool cancel(uint32_t id) {
+        for (size_t k = 0; k < live.size(); ++k) {
+            if (live[k].id == id) {
+                live.erase(live.begin() + k);
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    void push(const Event& event) { events.push(event); }
+    
+    const PriceView& bars;
+    const IndicatorSet& indicators;
+    const StrategyParams& params;
+    const ExecutionConfig& config;
+    
+    priority_queue<Event, vector<Event>, Later> events;
+    vector<Order> live;
+    uint32_t next_id = 1;            // 0 marks a cancelled order
+    uint32_t next_sequence = 1;
+    
+    double cash;
+    double initial_capital;
+    double shares = 0.0;
+    double entry_price = 0.0;
+    int consecutive_losses = 0;
+    bool entry_pending = false;      // Entry order submitted or live
+    bool exit_pending = false;
+    size_t protect_from = SIZE_MAX;  // Bar at which the bracket orders go live
+    MetricsAccumulator metrics;
+};
+
+// Bar length of a resampled series ("5m", "1h", "1d", "1w", ...). Buckets are
+// aligned to the epoch, and week buckets to Mondays.
+struct Timeframe {
+    int64_t seconds = Timestamp::SECONDS_PER_DAY;
+    string name = "1d";
+    
+    static Timeframe parse(const string& text) {
+        size_t digits = 0;
+        while (digits < text.size() && isdigit((unsigned char)text[digits])) digits++;
+        long count = digits > 0 ? atol(text.substr(0, digits).c_str()) : 1;
+        string unit = text.substr(digits);
+        
+        int64_t unit_seconds = 0;
+        if (unit == "s") unit_seconds = 1;
+        else if (unit == "m" || unit == "min") unit_seconds = 60;
+        else if (unit == "h") unit_seconds = 3600;
+        else if (unit == "d") unit_seconds = Timestamp::SECONDS_PER_DAY;
+        else if (unit == "w") unit_seconds = 7 * Timestamp::SECONDS_PER_DAY;
+        if (unit_seconds == 0 || count <= 0) {
+            throw runtime_error("Invalid timeframe (expected e.g. 5m, 1h, 1d, 1w): " + text);
+        }
+        
+        Timeframe timeframe;
+        timeframe.seconds = count * unit_seconds;
+        timeframe.name = text;
+        return timeframe;
+    }
+    
+    // Start of the bucket containing timestamp
+    int64_t bucketStart(int64_t timestamp) const {
+        // 1970-01-01 was a Thursday; week buckets start on Monday 1970-01-05
+        int64_t anchor = seconds % (7 * Timestamp::SECONDS_PER_DAY) == 0 ? 4 * Timestamp::SECONDS_PER_DAY : 0;
+        int64_t offset = timestamp - anchor;
+        int64_t bucket = offset >= 0 ? offset / seconds : -((-offset + seconds - 1) / seconds);
+        return bucket * seconds + anchor;
+    }
+    
+    int64_t bucketEnd(int64_t start) const { return start + seconds; }
+};
+
+// Aggregates one bar stream into any number of timeframes in a single pass:
+// each pushed bar updates the forming bar of every timeframe, which is
+// appended to that timeframe's series once a bar of a later bucket arrives
+// (or at finish()). Output bars are stamped with their bucket's start time.
+// Input timestamps must not decrease.
+class Resampler {
+public:
+    explicit Resampler(const vector<Timeframe>& timeframes) : timeframes(timeframes) {
+        forming.resize(timeframes.size());
+        output.resize(timeframes.size());
+    }
+    
+    void push(int64_t timestamp, double open, double high, double low, double close, double volume) {
+        for (size_t t = 0; t < timeframes.size(); ++t) {
+            int64_t start = timeframes[t].bucketStart(timestamp);
+            FormingBar& bar = forming[t];
+            if (bar.active && start == bar.start) {
+                bar.high = max(bar.high, high);
+                bar.low = min(bar.low, low);
+                bar.close = close;
+                bar.volume += volume;
+                continue;
+            }
+            if (bar.active) {
+                if (start < bar.start) {
+                    throw runtime_error("Resampler input is not in time order at " + Timestamp::format(timestamp));
+                }
+                emit(t);
+            }
+            bar.active = true;
+            bar.start = start;
+            bar.open = open;
+            bar.high = high;
+            bar.low = low;
+            bar.close = close;
+            bar.volume = volume;
+        }
+    }
+    
+    void push(const PriceView& prices) {
+        Profiler::Scope scope("resample", prices.size());
+        for (size_t i = 0; i < prices.size(); ++i) {
+            push(prices.timestamp[i], prices.open[i], prices.high[i], prices.low[i],
+                 prices.close[i], prices.volume[i]);
+        }
+    }
+    
+    // Closes every forming bar
+    void finish() {
+        for (size_t t = 0; t < timeframes.size(); ++t) {
+            if (forming[t].active) emit(t);
+        }
+    }
+    
+    size_t size() const { return timeframes.size(); }
+    const Timeframe& timeframe(size_t t) const { return timeframes[t]; }
+    const PriceSeries& series(size_t t) const { return output[t]; }
+    
+    static vector<PriceSeries> resample(const PriceView& prices, const vector<Timeframe>& timeframes) {
+        Resampler resampler(timeframes);
+        resampler.push(prices);
+        resampler.finish();
+        for (auto& series : resampler.output) series.symbol = prices.symbol;
+        return resampler.output;
+    }
+    
+private:
+    struct FormingBar {
+        bool active = false;
+        int64_t start = 0;
+        double open = 0, high = 0, low = 0, close = 0, volume = 0;
+    };
+    
+    void emit(size_t t) {
+        FormingBar& bar = forming[t];
+        PriceSeries& series = output[t];
+        series.timestamp.push_back(bar.start);
+        series.open.push_back(bar.open);
+        series.high.push_back(bar.high);
+        series.low.push_back(bar.low);
+        series.close.push_back(bar.close);
+        series.volume.push_back(bar.volume);
+        bar.active = false;
+    }
+    
+    vector<Timeframe> timeframes;
+    vector<FormingBar> forming;
+    vector<PriceSeries> output;
+};
+
+// Combines indicators of two timeframes of the same data without lookahead:
+// a bar of the higher timeframe only becomes visible to a lower-timeframe bar
+// once its whole bucket has ended, so e.g. an hourly bar sees the previous
+// day's daily bar, never the one still forming.
+class MultiTimeframe {
+public:
+    // For each bar of lower, the number of leading higher bars whose bucket
+    // ends no later than that bar's bucket.
+    static vector<size_t> completedBars(const PriceSeries& lower, const Timeframe& lower_timeframe,
+                                        const PriceSeries& higher, const Timeframe& higher_timeframe) {
+        vector<size_t> completed(lower.size());
+        size_t k = 0;
+        for (size_t j = 0; j < lower.size(); ++j) {
+            int64_t end = lower_timeframe.bucketEnd(lower.timestamp[j]);
+            while (k < higher.size() && higher_timeframe.bucketEnd(higher.timestamp[k]) <= end) k++;
+            completed[j] = k;
+        }
+        return completed;
+    }
+    
+    // Replaces the SMA 20 / SMA 50 columns of lower with those of the last
+    // completed higher bar, so every trend condition of the rule sets (e.g.
+    // Uptrend<20, 50>) follows the higher timeframe while RSI, MACD and the
+    // bands stay on the lower one. Until 50 higher bars have completed both
+    // columns are 0, which reads as "no uptrend".
+    static void applyTrendFilter(IndicatorSet& lower, const IndicatorSet& higher,
+                                 const vector<size_t>& completed) {
+        double* sma_20 = lower.column(IndicatorSet::SMA_20);
+        double* sma_50 = lower.column(IndicatorSet::SMA_50);
+        Span<double> higher_20 = higher.sma20();
+        Span<double> higher_50 = higher.sma50();
+        for (size_t j = 0; j < lower.size(); ++j) {
+            bool ready = completed[j] >= 50;
+            sma_20[j] = ready ? higher_20[completed[j] - 1] : 0.0;
+            sma_50[j] = ready ? higher_50[completed[j] - 1] : 0.0;
+        }
+    }
+};
+
+// Minimal "--flag value" parser for the command-line modes.
+class CommandLine {
+public:
+    CommandLine(int argc, char* argv[]) {
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            if (arg.compare(0, 2, "--") != 0) {
+                positional.push_back(arg);
+                continue;
+            }
+            arg = arg.substr(2);
+            if (i + 1 < argc && string(argv[i + 1]).compare(0, 2, "--") != 0) {
+                options[arg] = argv[++i];
+            } else {
+                options[arg] = "";
+            }
+        }
+    }
+    
+    bool has(const string& name) const { return options.count(name) > 0; }
+    
+    string get(const string& name, const string& fallback = "") const {
+        auto it = options.find(name);
+        return it != options.end() && !it->second.empty() ? it->second : fallback;
+    }
+    
+    long getInt(const string& name, long fallback) const {
+        return getNumber(name, fallback);
+    }
+    
+    // A count or size; negative values are rejected
+    size_t getCount(const string& name, size_t fallback) const {
+        long value = getNumber(name, (long)fallback);
+        if (value < 0) {
+            throw runtime_error("Invalid value for --" + name + ": " + get(name));
+        }
+        return (size_t)value;
+    }
+    
+    double getDouble(const string& name, double fallback) const {
+        return getNumber(name, fallback);
+    }
+    
+    vector<string> positional;
+    
+private:
+    template <typename T>
+    T getNumber(const string& name, T fallback) const {
+        string text = get(name);
+        if (text.empty()) return fallback;
+        T value;
+        if (!parseNumber(text, value)) {
+            throw runtime_error("Invalid value for --" + name + ": " + text);
+        }
+        return value;
+    }
+    
+    map<string, string> options;
+};
+
+// Strategy settings for a run: defaults, overridden by --config and then by
+// --rules.
+static StrategyParams loadStrategyParams(const CommandLine& args) {
+    StrategyParams params = args.has("config") ? StrategyConfig::load(args.get("config")) : StrategyParams();
+    if (args.has("rules")) {
+        int id = StrategyCatalog::find(args.get("rules"));
+        if (id < 0) {
+            throw runtime_error("Unknown rule set: " + args.get("rules"));
+        }
+        params.rule_set = id;
+    }
+    return params;
+}
+
+static int runBatchMode(const CommandLine& args) {
+    vector<BatchJob> jobs = BatchRunner::discoverJobs(args.get("batch"));
+    if (jobs.empty()) {
+        throw runtime_error("No CSV files found in batch source: " + args.get("batch"));
+    }
+    
+    string out_path = args.get("out", "batch_results.csv");
+    ofstream out(out_path.c_str());
+    if (!out.is_open()) {
+        throw runtime_error("Cannot open output file: " + out_path);
+    }
+    
+    size_t threads = args.getCount("threads", 0);
+    bool deterministic = args.has("deterministic");
+    
+    ResultSinkConfig outputs;
+    outputs.trades_csv = args.get("trades", "");
+    outputs.trades_symbol = true;
+    outputs.trades_binary = args.get("trades-bin", "");
+    
+    cout << "Running batch backtest on " << jobs.size() << " symbols with "
+         << (threads > 0 ? threads : ThreadPool::defaultThreadCount()) << " threads..." << endl;
+    vector<BatchResult> results = BatchRunner::run(jobs, out, threads, deterministic, 100000.0,
+                                                   loadStrategyParams(args), outputs, args.get("cache", ""));
+    
+    size_t failed = 0;
+    for (const auto& result : results) {
+        if (!result.error.empty()) failed++;
+    }
+    cout << "Wrote " << results.size() << " results to " << out_path;
+    if (failed > 0) cout << " (" << failed << " failed)";
+    cout << endl;
+    return failed > 0 ? 1 : 0;
+}
+
+static int runSweepMode(const CommandLine& args) {
+    string data_path = args.get("sweep", "prices.csv");
+    PriceSource source(data_path);
+    const PriceView& price_data = source.view();
+    if (price_data.size() < 50) {
+        throw runtime_error("Insufficient data for backtesting");
+    }
+    IndicatorSet indicators = TechnicalIndicators::calculateStrategyIndicators(price_data);
+    
+    StrategyParams base = loadStrategyParams(args);
+    vector<SweepDimension> dims = args.has("grid") ? ParameterSweep::parseGrid(args.get("grid"))
+                                                   : ParameterSweep::defaultGrid();
+    vector<StrategyParams> trials = args.has("samples")
+        ? ParameterSweep::sampleRandom(dims, args.getCount("samples", 1000), (uint64_t)args.getInt("seed", 42), base)
+        : ParameterSweep::expandGrid(dims, base);
+    
+    size_t threads = args.getCount("threads", 0);
+    cout << "Sweeping " << trials.size() << " parameter sets over " << price_data.size()
+         << " bars from " << data_path << "..." << endl;
+    
+    auto start = chrono::steady_clock::now();
+    vector<SweepResult> results = ParameterSweep::run(price_data, indicators, trials, threads);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    
+    string out_path = args.get("out", "sweep_results.csv");
+    ofstream out(out_path.c_str());
+    if (!out.is_open()) {
+        throw runtime_error("Cannot open output file: " + out_path);
+    }
+    ParameterSweep::writeResults(out, results);
+    
+    vector<size_t> order(results.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return results[a].metrics.sharpe > results[b].metrics.sharpe;
+    });
+    
+    cout << fixed << setprecision(2);
+    cout << "Completed in " << seconds << "s (" << setprecision(0)
+         << (seconds > 0 ? results.size() / seconds * 60 : 0) << " trials/min)" << endl;
+    cout << "Top parameter sets by Sharpe ratio:" << endl;
+    size_t top = min(order.size(), args.getCount("top", 5));
+    for (size_t i = 0; i < top; ++i) {
+        const SweepResult& r = results[order[i]];
+        cout << setprecision(3) << "  #" << order[i] << "  sharpe " << r.metrics.sharpe
+             << "  return " << setprecision(2) << (r.metrics.total_return * 100) << "%"
+             << "  | oversold " << r.params.rsi_oversold << " overbought " << r.params.rsi_overbought
+             << " stop " << r.params.stop_loss_pct << " take " << r.params.take_profit_pct
+             << " size " << r.params.position_size_pct << " max_losses " << r.params.max_consecutive_losses << endl;
+    }
+    cout << "Full results written to " << out_path << endl;
+    return 0;
+}
+
+static int runWalkForwardMode(const CommandLine& args) {
+    string data_path = args.get("walk-forward", "prices.csv");
+    PriceSource source(data_path);
+    const PriceView& price_data = source.view();
+    if (price_data.size() < 50) {
+        throw runtime_error("Insufficient data for backtesting");
+    }
+    IndicatorSet indicators = TechnicalIndicators::calculateStrategyIndicators(price_data);
+    
+    StrategyParams base = loadStrategyParams(args);
+    vector<SweepDimension> dims = args.has("grid") ? ParameterSweep::parseGrid(args.get("grid"))
+                                                   : ParameterSweep::defaultGrid();
+    vector<StrategyParams> trials = args.has("samples")
+        ? ParameterSweep::sampleRandom(dims, args.getCount("samples", 1000), (uint64_t)args.getInt("seed", 42), base)
+        : ParameterSweep::expandGrid(dims, base);
+    
+    size_t train = args.getCount("train", 252);
+    size_t test = args.getCount("test", 63);
+    vector<WalkForwardWindow> windows = WalkForward::makeWindows(price_data.size(), train, test, args.has("anchored"));
+    
+    cout << "Walk-forward over " << price_data.size() << " bars from " << data_path << ": "
+         << windows.size() << " windows (train " << train << ", test " << test
+         << (args.has("anchored") ? ", anchored" : "") << "), "
+         << trials.size() << " parameter sets per window..." << endl;
+    
+    auto start = chrono::steady_clock::now();
+    WalkForwardResult result = WalkForward::run(price_data, indicators, trials, windows,
+                                                args.getCount("threads", 0));
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    
+    cout << fixed;
+    for (size_t w = 0; w < result.windows.size(); ++w) {
+        const WalkForwardWindow& window = result.windows[w];
+        cout << setprecision(2) << "  #" << w << "  test " << Timestamp::format(price_data.timestamp[window.test_begin])
+             << " .. " << Timestamp::format(price_data.timestamp[window.test_end - 1])
+             << "  IS sharpe " << setprecision(3) << window.in_sample.sharpe
+             << "  OOS sharpe " << window.out_of_sample.sharpe
+             << "  OOS return " << setprecision(2) << (window.out_of_sample.total_return * 100) << "%"
+             << "  | oversold " << window.params.rsi_oversold << " overbought " << window.params.rsi_overbought
+             << " stop " << window.params.stop_loss_pct << " take " << window.params.take_profit_pct << endl;
+    }
+    cout << "Out-of-sample return: " << (result.totalReturn() * 100) << "% (final $"
+         << result.finalValue() << ") in " << seconds << "s" << endl;
+    cout << "Out-of-sample Sharpe " << setprecision(3) << result.combined.sharpe()
+         << ", Sortino " << result.combined.sortino() << ", max drawdown " << setprecision(2)
+         << (result.combined.maxDrawdown() * 100) << "% (" << result.combined.maxDrawdownBars() << " bars)" << endl;
+    
+    string out_path = args.get("out", "walk_forward.csv");
+    ofstream out(out_path.c_str());
+    if (!out.is_open()) {
+        throw runtime_error("Cannot open output file: " + out_path);
+    }
+    WalkForward::writeEquity(out, price_data, result);
+    cout << "Stitched equity curve written to " << out_path << endl;
+    return 0;
+}
+
+// Trades every symbol of a batch source (or synthetic random walks when no
+// source is given) through one PortfolioEngine account.
+static int runPortfolioMode(const CommandLine& args) {
+    string source = args.get("portfolio");
+    vector<unique_ptr<PriceSource>> sources;
+    vector<PriceSeries> synthetic;
+    vector<PriceView> views;
+    
+    auto load_start = chrono::steady_clock::now();
+    if (source.empty()) {
+        size_t symbols = args.getCount("symbols", 1000);
+        size_t bars = args.getCount("bars", 2520);
+        synthetic.resize(symbols);
+        ThreadPool pool(args.getCount("threads", 0));
+        pool.parallelFor(symbols, [&](size_t s) {
+            synthetic[s] = SyntheticData::randomWalk(bars, s + 1, 50.0 + (s % 200), 0.02);
+        });
+        for (const auto& series : synthetic) views.push_back(series.view());
+        source = "synthetic data";
+    } else {
+        vector<BatchJob> jobs = BatchRunner::discoverJobs(source);
+        if (jobs.empty()) {
+            throw runtime_error("No price files found in portfolio source: " + source);
+        }
+        sources.resize(jobs.size());
+        ThreadPool pool(args.getCount("threads", 0));
+        pool.parallelFor(jobs.size(), [&](size_t i) {
+            sources[i].reset(new PriceSource(jobs[i].path));
+            sources[i]->setSymbol(jobs[i].symbol);
+        });
+        for (const auto& price_source : sources) views.push_back(price_source->view());
+    }
+    double load_seconds = chrono::duration<double>(chrono::steady_clock::now() - load_start).count();
+    
+    PortfolioLimits limits;
+    limits.position_pct = args.getDouble("position-pct", limits.position_pct);
+    limits.max_exposure_pct = args.getDouble("max-exposure", limits.max_exposure_pct);
+    limits.max_positions = args.getCount("max-positions", limits.max_positions);
+    double initial_cash = args.getDouble("cash", 1000000.0);
+    
+    size_t total_bars = 0;
+    for (const auto& view : views) total_bars += view.size();
+    cout << "Portfolio backtest of " << views.size() << " symbols (" << total_bars << " bars) from "
+         << source << "..." << endl;
+    
+    auto start = chrono::steady_clock::now();
+    PortfolioResult result = PortfolioEngine::run(views, loadStrategyParams(args), limits, initial_cash);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    
+    cout << fixed << setprecision(2);
+    cout << "Initial Capital:        $" << result.initial_capital << endl;
+    cout << "Final Portfolio:        $" << result.final_value << endl;
+    cout << "Total Return:           " << (result.totalReturn() * 100) << "%" << endl;
+    cout << "Max Drawdown:           " << (result.max_drawdown * 100) << "%" << endl;
+    cout << "Peak Exposure:          " << (result.peak_exposure * 100) << "%" << endl;
+    cout << "Buy / Sell Trades:      " << result.buy_trades << " / " << result.sell_trades << endl;
+    cout << "Winning Exits:          " << result.winning_trades << endl;
+    cout << "Skipped Buy Signals:    " << result.skipped_buys << endl;
+    cout << "Open Positions:         " << result.open_positions << endl;
+    cout << "Load " << load_seconds << "s, simulate " << seconds << "s ("
+         << setprecision(1) << (seconds > 0 ? result.bars / seconds / 1e6 : 0) << "M bars/s)" << endl;
+    
+    string out_path = args.get("out", "portfolio_equity.csv");
+    ofstream out(out_path.c_str());
+    if (!out.is_open()) {
+        throw runtime_error("Cannot open output file: " + out_path);
+    }
+    out << "date,equity" << "\n" << fixed << setprecision(2);
+    for (size_t i = 0; i < result.equity.size(); ++i) {
+        out << Timestamp::format(result.timestamps[i]) << "," << result.equity[i] << "\n";
+    }
+    cout << "Equity curve written to " << out_path << endl;
+    return 0;
+}
+
+static int runMonteCarloMode(const CommandLine& args) {
+    string data_path = args.get("monte-carlo", "prices.csv");
+    PriceSource source(data_path);
+    const PriceView& price_data = source.view();
+    
+    MonteCarloConfig config;
+    string model = args.get("model", "bootstrap");
+    if (model == "gbm") {
+        config.model = PathModel::GBM;
+    } else if (model != "bootstrap") {
+        throw runtime_error("Unknown path model (expected bootstrap or gbm): " + model);
+    }
+    config.paths = args.getCount("paths", 1000);
+    config.bars = args.getCount("bars", 0);
+    config.block = args.getCount("block", 10);
+    config.seed = (uint64_t)args.getInt("seed", 42);
+    config.threads = args.getCount("threads", 0);
+    config.params = loadStrategyParams(args);
+    
+    cout << "Monte Carlo: " << config.paths << " " << model << " paths of "
+         << (config.bars > 0 ? config.bars : price_data.size()) << " bars from " << data_path << "..." << endl;
+    
+    auto start = chrono::steady_clock::now();
+    MonteCarloResult result = MonteCarlo::run(price_data, config);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    
+    AdvancedTradingStrategy strategy(config.initial_cash, config.params);
+    strategy.setVerbose(false);
+    strategy.backtest(price_data);
+    PerformanceMetrics observed = strategy.calculatePerformanceMetrics(price_data);
+    
+    cout << fixed << setprecision(2);
+    cout << "Completed in " << seconds << "s (" << setprecision(0)
+         << (seconds > 0 ? config.paths / seconds : 0) << " paths/s)" << endl;
+    cout << "Metric          Observed        p5       p25       p50       p75       p95      mean" << endl;
+    auto row = [](const string& name, double observed, const Percentiles& p, double scale) {
+        cout << left << setw(14) << name << right << setprecision(3)
+             << setw(10) << observed * scale << setw(10) << p.p05 * scale << setw(10) << p.p25 * scale
+             << setw(10) << p.p50 * scale << setw(10) << p.p75 * scale << setw(10) << p.p95 * scale
+             << setw(10) << p.mean * scale << endl;
+    };
+    row("Sharpe", observed.sharpe, result.sharpe, 1.0);
+    row("Max DD %", observed.max_drawdown, result.max_drawdown, 100.0);
+    row("Return %", observed.total_return, result.total_return, 100.0);
+    row("Alpha %", observed.alpha(), result.alpha, 100.0);
+    
+    string out_path = args.get("out", "monte_carlo.csv");
+    ofstream out(out_path.c_str());
+    if (!out.is_open()) {
+        throw runtime_error("Cannot open output file: " + out_path);
+    }
+    MonteCarlo::writePaths(out, result);
+    cout << "Per-path metrics written to " << out_path << endl;
+    return 0;
+}
+
+// Runs the strategy through ExecutionEngine (OHLC-aware fills with costs) and
+// compares it with the close-only backtest.
+static int runExecutionMode(const CommandLine& args) {
+    string data_path = args.get("execute", "prices.csv");
+    PriceSource source(data_path);
+    const PriceView& bars = source.view();
+    if (bars.size() < AdvancedTradingStrategy::WARMUP_BARS) {
+        throw runtime_error("Insufficient data for backtesting");
+    }
+    
+    ExecutionConfig config;
+    string entry = args.get("entry", "market");
+    if (entry == "limit") {
+        config.entry_type = OrderType::Limit;
+    } else if (entry == "stop") {
+        config.entry_type = OrderType::Stop;
+    } else if (entry != "market") {
+        throw runtime_error("Unknown entry order type (expected market, limit or stop): " + entry);
+    }
+    config.entry_offset_pct = args.getDouble("entry-offset", config.entry_offset_pct);
+    config.entry_expiry_bars = args.getCount("expiry", config.entry_expiry_bars);
+    config.latency_bars = args.getCount("latency", config.latency_bars);
+    config.commission.per_order = args.getDouble("commission-order", 0.0);
+    config.commission.per_share = args.getDouble("commission-share", 0.0);
+    config.commission.bps = args.getDouble("commission-bps", 0.0);
+    config.commission.minimum = args.getDouble("commission-min", 0.0);
+    config.slippage.bps = args.getDouble("slippage-bps", 0.0);
+    config.slippage.range_fraction = args.getDouble("slippage-range", 0.0);
+    StrategyParams params = loadStrategyParams(args);
+    
+    IndicatorSet indicators;
+    IndicatorEngine engine;
+    engine.compute(bars.close, indicators);
+    
+    cout << "Event-driven execution of " << bars.size() << " bars from " << data_path << " ("
+         << orderTypeName(config.entry_type) << " entries, latency " << max((size_t)1, config.latency_bars)
+         << " bar)..." << endl;
+    
+    auto start = chrono::steady_clock::now();
+    ExecutionResult result = ExecutionEngine::run(bars, indicators, params, config);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    
+    AdvancedTradingStrategy strategy(100000.0, params);
+    strategy.setVerbose(false);
+    strategy.setRecordHistory(false);
+    strategy.backtest(bars, indicators);
+    PerformanceMetrics close_only = strategy.calculatePerformanceMetrics(bars);
+    
+    const PerformanceMetrics& m = result.metrics;
+    cout << fixed << setprecision(2);
+    cout << "Initial Capital:        $" << m.initial_capital << endl;
+    cout << "Final Portfolio:        $" << m.final_value << endl;
+    cout << "Total Return:           " << (m.total_return * 100) << "% (close fills: "
+         << (close_only.total_return * 100) << "%)" << endl;
+    cout << "Buy & Hold Return:      " << (m.buy_hold_return * 100) << "%" << endl;
+    cout << "Sharpe Ratio:           " << setprecision(3) << m.sharpe << " (close fills: "
+         << close_only.sharpe << ")" << endl;
+    cout << "Maximum Drawdown:       " << setprecision(2) << (m.max_drawdown * 100) << "%" << endl;
+    cout << "Buy / Sell Trades:      " << m.buy_trades << " / " << m.sell_trades << endl;
+    cout << "Win Rate:               " << m.win_rate << "%" << endl;
+    cout << "Commission Paid:        $" << result.commission_paid << endl;
+    cout << "Slippage Paid:          $" << result.slippage_paid << endl;
+    cout << "Expired Entry Orders:   " << result.expired_orders << endl;
+    cout << "Simulated " << result.bars << " bars (" << result.events << " events) in " << setprecision(4)
+         << seconds << "s (" << setprecision(1) << (seconds > 0 ? result.bars / seconds / 1e6 : 0)
+         << "M bars/s)" << endl;
+    
+    string out_path = args.get("out", "execution_fills.csv");
+    ofstream out(out_path.c_str());
+    if (!out.is_open()) {
+        throw runtime_error("Cannot open output file: " + out_path);
+    }
+    out << "date,bar,action,order,reason,price,shares,commission" << "\n" << fixed << setprecision(4);
+    for (const ExecutionFill& fill : result.fills) {
+        out << Timestamp::format(fill.timestamp) << "," << fill.bar << "," << actionName(fill.action) << ","
+            << orderTypeName(fill.type) << "," << ReasonTable::name(fill.reason) << "," << fill.price << ","
+            << fill.shares << "," << fill.commission << "\n";
+    }
+    cout << "Fills written to " << out_path << endl;
+    return 0;
+}
+
+// Resamples a price file into several timeframes and backtests each one.
+static int runResampleMode(const CommandLine& args) {
+    string data_path = args.get("resample", "prices.csv");
+    PriceSource source(data_path);
+    const PriceView& bars = source.view();
+    
+    vector<Timeframe> timeframes;
+    stringstream list(args.get("timeframes", "1h,1d,1w"));
+    string item;
+    while (getline(list, item, ',')) {
+        if (!item.empty()) timeframes.push_back(Timeframe::parse(item));
+    }
+    
+    // The trend timeframe is resampled in the same pass even if not listed
+    size_t listed = timeframes.size();
+    bool use_trend = args.has("trend");
+    size_t trend_index = listed;
+    if (use_trend) {
+        Timeframe trend = Timeframe::parse(args.get("trend"));
+        for (size_t t = 0; t < listed; ++t) {
+            if (timeframes[t].seconds == trend.seconds) trend_index = t;
         }
-        
-        return rsi;
+        if (trend_index == listed) timeframes.push_back(trend);
+    }
+    if (listed == 0) {
+        throw runtime_error("No timeframes given");
     }
     
-    static MACDResult calculateMACD(const vector<double>& prices, int fast_period = 12, int slow_period = 26, int signal_period = 9) {
-        
-        vector<double> ema_fast = calculateEMA(prices, fast_period);
-        vector<double> ema_slow = calculateEMA(prices, slow_period);
-        vector<double> macd(prices.size(), 0.0);
-        
-        for (size_t i = 0; i < prices.size(); ++i) {
-            macd[i] = ema_fast[i] - ema_slow[i];
+    auto start = chrono::steady_clock::now();
+    vector<PriceSeries> series = Resampler::resample(bars, timeframes);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Resampled " << bars.size() << " bars from " << data_path << " into " << timeframes.size()
+         << " timeframes in " << fixed << setprecision(4) << seconds << "s" << endl;
+    
+    vector<IndicatorSet> indicators(timeframes.size());
+    IndicatorEngine engine;
+    for (size_t t = 0; t < timeframes.size(); ++t) {
+        engine.compute(Span<double>(series[t].close), indicators[t]);
+    }
+    
+    string out_path = args.get("out", "resample_results.csv");
+    ofstream out(out_path.c_str());
+    if (!out.is_open()) {
+        throw runtime_error("Cannot open output file: " + out_path);
+    }
+    out << "timeframe,bars,trend,final_value,total_return,buy_hold_return,sharpe,max_drawdown,"
+        << "buy_trades,sell_trades,win_rate" << "\n" << fixed << setprecision(6);
+    
+    StrategyParams params = loadStrategyParams(args);
+    cout << left << setw(10) << "Timeframe" << setw(10) << "Bars" << setw(8) << "Trend"
+         << setw(11) << "Return" << setw(9) << "Sharpe" << setw(11) << "Drawdown" << "Trades" << right << endl;
+    for (size_t t = 0; t < listed; ++t) {
+        const PriceSeries& s = series[t];
+        bool filtered = use_trend && timeframes[trend_index].seconds > timeframes[t].seconds;
+        cout << left << setw(10) << timeframes[t].name << setw(10) << s.size()
+             << setw(8) << (filtered ? timeframes[trend_index].name : string("-")) << right;
+        if (s.size() < AdvancedTradingStrategy::WARMUP_BARS) {
+            cout << "skipped (fewer than " << AdvancedTradingStrategy::WARMUP_BARS << " bars)" << endl;
+            continue;
         }
         
-        vector<double> signal = calculateEMA(macd, signal_period);
-        vector<double> histogram(prices.size());
-        
-        for (size_t i = 0; i < prices.size(); ++i) {
-            histogram[i] = macd[i] - signal[i];
+        IndicatorSet signal_indicators = indicators[t];
+        if (filtered) {
+            vector<size_t> completed = MultiTimeframe::completedBars(s, timeframes[t], series[trend_index],
+                                                                     timeframes[trend_index]);
+            MultiTimeframe::applyTrendFilter(signal_indicators, indicators[trend_index], completed);
         }
         
-        MACDResult result;
-        result.macd = macd;
-        result.signal = signal;
-        result.histogram = histogram;
+        PriceView price_data = s.view();
+        AdvancedTradingStrategy strategy(100000.0, params);
+        strategy.setVerbose(false);
+        strategy.backtest(price_data, signal_indicators);
+        PerformanceMetrics m = strategy.calculatePerformanceMetrics(price_data);
         
-        return result;
+        // The metrics annualize per-bar returns at 252 bars a year; rescale
+        // the Sharpe ratio to this timeframe's bars per year
+        double years = (double)(s.timestamp.back() - s.timestamp.front()) / (365.25 * Timestamp::SECONDS_PER_DAY);
+        double sharpe = years > 0 ? m.sharpe * sqrt(s.size() / years / MetricsAccumulator::PERIODS_PER_YEAR) : m.sharpe;
+        
+        cout << setprecision(2) << setw(9) << (m.total_return * 100) << "% " << setprecision(3) << setw(8)
+             << sharpe << " " << setprecision(2) << setw(9) << (m.max_drawdown * 100) << "% "
+             << m.buy_trades << "/" << m.sell_trades << endl;
+        out << timeframes[t].name << "," << s.size() << "," << (filtered ? timeframes[trend_index].name : "") << ","
+            << m.final_value << "," << m.total_return << "," << m.buy_hold_return << "," << sharpe << ","
+            << m.max_drawdown << "," << m.buy_trades << "," << m.sell_trades << "," << m.win_rate << "\n";
     }
+    cout << "Results written to " << out_path << endl;
+    return 0;
+}
+
+// Compares the getline/stringstream CSVParser with the memory-mapped
+// FastCSVParser on the same file.
+static int runCsvBenchmark(const CommandLine& args) {
+    string path = args.get("bench-csv", "prices.csv");
+    int repeat = max(1, (int)args.getInt("repeat", 5));
+    double megabytes = std::filesystem::file_size(path) / (1024.0 * 1024.0);
     
-    static vector<double> calculateBollingerBands(const vector<double>& prices, int period = 20, double std_dev = 2.0) {
-        vector<double> bb_lower(prices.size(), 0.0);
-        
-        for (size_t i = period - 1; i < prices.size(); ++i) {
-            double sum = 0.0;
-            for (int j = 0; j < period; ++j) {
-                sum += prices[i - j];
-            }
-            double sma = sum / period;
-            
-            double variance = 0.0;
-            for (int j = 0; j < period; ++j) {
-                variance += pow(prices[i - j] - sma, 2);
-            }
-            double std = sqrt(variance / period);
-            
-            bb_lower[i] = sma - (std * std_dev);
+    auto timeBest = [&](const function<size_t()>& load) {
+        double best = 1e300;
+        size_t rows = 0;
+        for (int r = 0; r < repeat; ++r) {
+            auto start = chrono::steady_clock::now();
+            rows = load();
+            best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
         }
-        
-        return bb_lower;
-    }
-};
+        return make_pair(best, rows);
+    };
+    
+    auto legacy = timeBest([&] { return CSVParser::loadPriceData(path).size(); });
+    auto fast = timeBest([&] { return FastCSVParser::loadPriceSeries(path).size(); });
+    
+    // Binary store: open the mapping and touch every close once
+    string binary_path = (std::filesystem::temp_directory_path() / "finsimx_bench.fsx").string();
+    BinaryPriceFile::write(FastCSVParser::loadPriceSeries(path).view(), binary_path);
+    double checksum = 0.0;
+    auto binary = timeBest([&] {
+        BinaryPriceFile file(binary_path);
+        for (double c : file.view().close) checksum += c;
+        return file.view().size();
+    });
+    std::filesystem::remove(binary_path);
+    
+    cout << "CSV load benchmark: " << path << " (" << fixed << setprecision(2) << megabytes
+         << " MB, best of " << repeat << ")" << endl;
+    cout << "  CSVParser:       " << setprecision(4) << legacy.first << "s  " << legacy.second << " rows  "
+         << setprecision(1) << megabytes / legacy.first << " MB/s" << endl;
+    cout << "  FastCSVParser:   " << setprecision(4) << fast.first << "s  " << fast.second << " rows  "
+         << setprecision(1) << megabytes / fast.first << " MB/s" << endl;
+    cout << "  BinaryPriceFile: " << setprecision(4) << binary.first << "s  " << binary.second << " rows  "
+         << "(mmap + one pass over close, checksum " << setprecision(0) << checksum << ")" << endl;
+    cout << "  Speedup:         " << setprecision(1) << legacy.first / fast.first << "x (CSV), "
+         << legacy.first / binary.first << "x (binary)" << endl;
+    return 0;
+}
 
-class CSVParser {
-public:
-    static vector<PriceData> loadPriceData(const string& filename) {
-        vector<PriceData> data;
-        ifstream file(filename.c_str());
-        
-        if (!file.is_open()) {
-            throw runtime_error("Cannot open file: " + filename);
+// Checks the O(n) rolling SMA / Bollinger kernels against the original
+// per-window recomputation on long random walks (crossing many RollingStats
+// resyncs) and on series around the window length. Means are compared
+// relative to the price level; the stddev and the bands are compared through
+// the variance they imply, relative to the squared price level, since the
+// square root of a near-zero variance magnifies any rounding. Exits 1 if an
+// error exceeds --tolerance.
+static double varianceError(double std_actual, double std_expected, double level) {
+    return fabs(std_actual * std_actual - std_expected * std_expected) / (level * level);
+}
+
+static int runRollingCheckMode(const CommandLine& args) {
+    size_t bars = (size_t)max(1L, args.getInt("bars", 200000));
+    double tolerance = args.getDouble("tolerance", 1e-9);
+    vector<int> periods;
+    stringstream period_list(args.get("periods", "2,20,50,200"));
+    string item;
+    while (getline(period_list, item, ',')) {
+        if (!item.empty()) periods.push_back(atoi(item.c_str()));
+    }
+    
+    // A plain random walk, and a high-priced low-volatility one where the
+    // variance is small next to the squared mean
+    vector<pair<string, PriceSeries>> cases;
+    cases.push_back(make_pair(string("walk"), SyntheticData::randomWalk(bars, 1)));
+    cases.push_back(make_pair(string("high-level"), SyntheticData::randomWalk(bars, 2, 10000.0, 0.0005)));
+    for (int period : periods) {
+        for (int delta : {-1, 0, 1}) {
+            if (period + delta <= 0) continue;
+            cases.push_back(make_pair("short-" + to_string(period + delta),
+                                      SyntheticData::randomWalk(period + delta, 3)));
         }
-        
-        string line;
-        bool first_line = true;
-        
-        while (getline(file, line)) {
-            if (first_line) {
-                first_line = false;
+    }
+    
+    cout << "Rolling kernel check: " << bars << " bars, resync every " << RollingStats::RESYNC_INTERVAL
+         << " pushes, tolerance " << scientific << setprecision(1) << tolerance << fixed << endl;
+    bool ok = true;
+    for (int period : periods) {
+        double worst = 0.0;
+        string worst_where = "-";
+        for (const auto& c : cases) {
+            if (c.first.compare(0, 6, "short-") == 0 && abs(atoi(c.first.c_str() + 6) - period) > 1) continue;
+            Span<double> close(c.second.close);
+            vector<double> sma = TechnicalIndicators::calculateSMA(close, period);
+            vector<double> sma_reference = TechnicalIndicators::calculateSMAReference(close, period);
+            BollingerResult bands = TechnicalIndicators::calculateBollingerBandsFull(close, period, 2.0);
+            BollingerResult bands_reference = TechnicalIndicators::calculateBollingerBandsReference(close, period, 2.0);
+            
+            if (sma.size() != close.size() || bands.stddev.size() != close.size()) {
+                worst = INFINITY;
+                worst_where = c.first + " size";
                 continue;
             }
-            
-            if (line.empty()) continue;
-            
-            try {
-                PriceData price_data = parseLine(line);
-                if (price_data.close > 0) {
-                    data.push_back(price_data);
+            for (size_t i = 0; i < close.size(); ++i) {
+                double level = max(1e-12, fabs(sma_reference[i]));
+                double std_expected = bands_reference.stddev[i];
+                double errors[] = {
+                    fabs(sma[i] - sma_reference[i]) / level,
+                    fabs(bands.middle[i] - bands_reference.middle[i]) / level,
+                    varianceError(bands.stddev[i], std_expected, level),
+                    varianceError((bands.upper[i] - bands.middle[i]) / 2.0, std_expected, level),
+                    varianceError((bands.middle[i] - bands.lower[i]) / 2.0, std_expected, level),
+                };
+                const char* names[] = {"SMA", "middle", "stddev", "upper", "lower"};
+                for (int o = 0; o < 5; ++o) {
+                    if (!(errors[o] <= worst)) {
+                        worst = errors[o];
+                        worst_where = c.first + " " + names[o] + " bar " + to_string(i);
+                    }
                 }
-            } catch (const exception& e) {
-                cerr << "Error parsing line: " << line << " - " << e.what() << endl;
             }
         }
-        
-        if (data.empty()) {
-            throw runtime_error("No valid price data found in file");
-        }
-        
-        return data;
+        bool within = worst <= tolerance;
+        ok = ok && within;
+        cout << "  period " << setw(4) << period << ": max rel error " << scientific << setprecision(2) << worst
+             << fixed << " [" << worst_where << "]" << (within ? "" : "  EXCEEDS TOLERANCE") << endl;
     }
+    cout << (ok ? "OK" : "FAILED") << endl;
+    return ok ? 0 : 1;
+}
+
+// Converts a CSV price file into the columnar .fsx binary format.
+static int runConvertMode(const CommandLine& args) {
+    string in_path = args.get("convert");
+    PriceSeries series = FastCSVParser::loadPriceSeries(in_path);
+    if (args.has("symbol")) series.symbol = args.get("symbol");
     
-private:
-    static PriceData parseLine(const string& line) {
-        PriceData data;
-        stringstream ss(line);
-        string field;
-        int field_count = 0;
-        
-        while (getline(ss, field, ',')) {
-            try {
-                switch (field_count) {
-                    case 0: data.date = field; break;
-                    case 1: data.open = atof(field.c_str()); break;
-                    case 2: data.high = atof(field.c_str()); break;
-                    case 3: data.low = atof(field.c_str()); break;
-                    case 4: data.close = atof(field.c_str()); break;
-                    case 5: data.volume = atof(field.c_str()); break;
-                }
-                field_count++;
-            } catch (const exception& e) {
-                throw runtime_error("Invalid number format in field: " + field);
+    string out_path = args.get("out", std::filesystem::path(in_path).replace_extension(".fsx").string());
+    BinaryPriceFile::write(series.view(), out_path);
+    cout << "Wrote " << series.size() << " " << series.symbol << " bars to " << out_path << endl;
+    return 0;
+}
+
+// Replays a price file through the streaming step() path and checks that it
+// reproduces the batch backtest() trade history exactly.
+static int runReplayMode(const CommandLine& args) {
+    string data_path = args.get("replay", "prices.csv");
+    PriceSource source(data_path);
+    const PriceView& price_data = source.view();
+    
+    StrategyParams params = loadStrategyParams(args);
+    AdvancedTradingStrategy batch(100000.0, params);
+    batch.setVerbose(false);
+    batch.backtest(price_data);
+    
+    AdvancedTradingStrategy live(100000.0, params);
+    live.setVerbose(false);
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < price_data.size(); ++i) {
+        live.step(price_data.at(i));
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    
+    const TradeLog& expected = batch.getTradeLog();
+    const TradeLog& actual = live.getTradeLog();
+    size_t mismatches = 0;
+    if (expected.equity() != actual.equity()) {
+        cout << "Equity curves differ (batch " << expected.bars() << " bars, streaming "
+             << actual.bars() << " bars)" << endl;
+        mismatches++;
+    }
+    if (expected.fills().size() != actual.fills().size()) {
+        cout << "Fill count differs: batch " << expected.fills().size()
+             << ", streaming " << actual.fills().size() << endl;
+        mismatches++;
+    }
+    for (size_t i = 0; i < min(expected.fills().size(), actual.fills().size()); ++i) {
+        const TradingSignal& a = expected.fills()[i];
+        const TradingSignal& b = actual.fills()[i];
+        if (a.timestamp != b.timestamp || a.bar != b.bar || a.action != b.action || a.reason != b.reason ||
+            a.price != b.price || a.rsi != b.rsi || a.macd != b.macd || a.signal != b.signal ||
+            a.portfolio_value != b.portfolio_value) {
+            if (mismatches++ < 10) {
+                cout << "Mismatch at " << a.date() << ": batch " << actionName(a.action) << " ("
+                     << a.reasonText() << "), streaming " << actionName(b.action) << " ("
+                     << b.reasonText() << ")" << endl;
             }
         }
-        
-        if (field_count < 5) {
-            throw runtime_error("Insufficient fields in CSV line");
-        }
-        
-        return data;
     }
-};
+    
+    cout << "Replayed " << price_data.size() << " bars from " << data_path << " in "
+         << fixed << setprecision(4) << seconds << "s (" << setprecision(0)
+         << (seconds > 0 ? price_data.size() / seconds : 0) << " bars/s)" << endl;
+    if (mismatches > 0) {
+        cout << "FAILED: streaming signals differ from batch backtest (" << mismatches << " mismatches)" << endl;
+        return 1;
+    }
+    cout << "OK: " << actual.bars() << " streaming bars and " << actual.fills().size()
+         << " fills match batch backtest" << endl;
+    return 0;
+}
 
-class AdvancedTradingStrategy {
-private:
-    double cash;
-    double shares;
-    double initial_capital;
-    vector<TradingSignal> trade_history;
+// Times the batched cross-symbol kernels at every supported SIMD level
+// against per-symbol TechnicalIndicators calls and reports the largest
+// relative deviation from the scalar reference.
+static int runSimdBenchmark(const CommandLine& args) {
+    size_t symbols = (size_t)max(1L, args.getInt("symbols", 256));
+    size_t bars = (size_t)max(60L, args.getInt("bars", 2520));
     
-    // Strategy parameters
-    double rsi_oversold = 25.0;      // More aggressive oversold
-    double rsi_overbought = 75.0;    // More aggressive overbought
-    double rsi_neutral_low = 45.0;   // RSI neutral zone
-    double rsi_neutral_high = 55.0;  // RSI neutral zone
+    vector<PriceSeries> universe;
+    vector<Span<double>> closes;
+    universe.reserve(symbols);
+    for (size_t s = 0; s < symbols; ++s) {
+        universe.push_back(SyntheticData::randomWalk(bars, s + 1));
+    }
+    for (const auto& series : universe) closes.push_back(series.close);
+    InterleavedSeries packed = InterleavedSeries::pack(closes);
     
-    // Risk management
-    double stop_loss_pct = 0.08;     // 8% stop loss
-    double take_profit_pct = 0.12;   // 12% take profit
-    double position_size_pct = 0.90; // Use 90% of available cash
+    enum { SMA, EMA, RSI, MACD, SIGNAL, HISTOGRAM, BB_LOWER, OUTPUT_COUNT };
+    const char* names[OUTPUT_COUNT] = {"SMA20", "EMA12", "RSI14", "MACD", "Signal", "Histogram", "BB lower"};
     
-    double entry_price = 0.0;
-    int consecutive_losses = 0;
-    int max_consecutive_losses = 3;
+    auto start = chrono::steady_clock::now();
+    vector<vector<vector<double>>> reference(OUTPUT_COUNT, vector<vector<double>>(symbols));
+    for (size_t s = 0; s < symbols; ++s) {
+        reference[SMA][s] = TechnicalIndicators::calculateSMA(closes[s], 20);
+        reference[EMA][s] = TechnicalIndicators::calculateEMA(closes[s], 12);
+        reference[RSI][s] = TechnicalIndicators::calculateRSI(closes[s], 14);
+        MACDResult macd = TechnicalIndicators::calculateMACD(closes[s], 12, 26, 9);
+        reference[MACD][s] = macd.macd;
+        reference[SIGNAL][s] = macd.signal;
+        reference[HISTOGRAM][s] = macd.histogram;
+        reference[BB_LOWER][s] = TechnicalIndicators::calculateBollingerBands(closes[s], 20, 2.0);
+    }
+    double reference_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
     
-public:
-    AdvancedTradingStrategy(double initial_cash = 100000.0) 
-        : cash(initial_cash), shares(0.0), initial_capital(initial_cash) {}
+    cout << "SIMD kernel benchmark: " << symbols << " symbols x " << bars << " bars" << endl;
+    cout << fixed << setprecision(4);
+    cout << "  per-symbol TechnicalIndicators: " << reference_seconds << "s" << endl;
     
-    void backtest(const vector<PriceData>& price_data) {
-        if (price_data.size() < 50) {
-            throw runtime_error("Insufficient data for backtesting");
-        }
+    SimdLevel detected = BatchIndicators::detectLevel();
+    bool ok = true;
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (level > detected) continue;
+        BatchIndicators::setLevel(level);
         
-        vector<double> prices;
-        for (const auto& data : price_data) {
-            prices.push_back(data.close);
+        // The first pass sizes (and page in) the outputs; the second is timed
+        vector<InterleavedSeries> outputs(OUTPUT_COUNT);
+        double seconds = 0.0;
+        for (int pass = 0; pass < 2; ++pass) {
+            start = chrono::steady_clock::now();
+            BatchIndicators::sma(packed, 20, outputs[SMA]);
+            BatchIndicators::ema(packed, 12, outputs[EMA]);
+            BatchIndicators::rsi(packed, 14, outputs[RSI]);
+            BatchIndicators::macd(packed, outputs[MACD], outputs[SIGNAL], outputs[HISTOGRAM], 12, 26, 9);
+            BatchIndicators::bollingerLower(packed, 20, 2.0, outputs[BB_LOWER]);
+            seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
         }
         
-        // Calculate indicators
-        vector<double> rsi = TechnicalIndicators::calculateRSI(prices, 14);
-        vector<double> rsi_short = TechnicalIndicators::calculateRSI(prices, 7);  // Faster RSI
-        MACDResult macd_result = TechnicalIndicators::calculateMACD(prices, 12, 26, 9);
-        vector<double> sma_20 = TechnicalIndicators::calculateSMA(prices, 20);
-        vector<double> sma_50 = TechnicalIndicators::calculateSMA(prices, 50);
-        vector<double> bb_lower = TechnicalIndicators::calculateBollingerBands(prices, 20, 2.0);
-        
-        cout << "Starting backtest with " << price_data.size() << " data points..." << endl;
-        cout << "Initial capital: $" << initial_capital << endl << endl;
-        
-        // Start trading after indicators stabilize
-        for (size_t i = 50; i < price_data.size(); ++i) {
-            double current_price = prices[i];
-            double current_rsi = rsi[i];
-            double current_rsi_short = rsi_short[i];
-            double current_macd = macd_result.macd[i];
-            double current_signal = macd_result.signal[i];
-            double prev_macd = macd_result.macd[i-1];
-            double prev_signal = macd_result.signal[i-1];
-            
-            // Trend detection
-            bool uptrend = sma_20[i] > sma_50[i];
-            bool macd_bullish = current_macd > current_signal;
-            bool macd_crossover_up = (prev_macd <= prev_signal) && (current_macd > current_signal);
-            bool macd_crossover_down = (prev_macd >= prev_signal) && (current_macd < current_signal);
-            
-            string action = "HOLD";
-            string reason = "";
-            
-            // Risk management - Stop loss and take profit
-            if (shares > 0 && entry_price > 0) {
-                double current_return = (current_price - entry_price) / entry_price;
-                
-                // Stop loss
-                if (current_return <= -stop_loss_pct) {
-                    executeTrade(price_data[i], "SELL", "Stop Loss", current_rsi, current_macd, current_signal);
-                    consecutive_losses++;
-                    continue;
-                }
-                // Take profit
-                if (current_return >= take_profit_pct) {
-                    executeTrade(price_data[i], "SELL", "Take Profit", current_rsi, current_macd, current_signal);
-                    consecutive_losses = 0;
-                    continue;
-                }
-            }
-            
-            // BUY SIGNALS (Multiple conditions for higher probability)
-            if (shares == 0 && cash > current_price && consecutive_losses < max_consecutive_losses) {
-                
-                // Signal 1: Strong oversold with MACD confirmation
-                if (current_rsi < rsi_oversold && current_rsi_short < 30 && 
-                    macd_bullish && uptrend) {
-                    executeTrade(price_data[i], "BUY", "Strong Oversold + MACD Bull + Uptrend", 
-                               current_rsi, current_macd, current_signal);
-                    continue;
-                }
-                
-                // Signal 2: MACD bullish crossover with RSI confirmation
-                if (macd_crossover_up && current_rsi > 30 && current_rsi < 60 && uptrend) {
-                    executeTrade(price_data[i], "BUY", "MACD Crossover + RSI Neutral + Uptrend", 
-                               current_rsi, current_macd, current_signal);
-                    continue;
-                }
-                
-                // Signal 3: Bounce from Bollinger Band lower with RSI oversold
-                if (current_price <= bb_lower[i] * 1.02 && current_rsi < 35 && 
-                    current_price > prices[i-1]) {  // Price bouncing up
-                    executeTrade(price_data[i], "BUY", "BB Lower Bounce + RSI Oversold", 
-                               current_rsi, current_macd, current_signal);
-                    continue;
-                }
-                
-                // Signal 4: Simple RSI oversold in uptrend
-                if (current_rsi < 30 && uptrend && macd_result.histogram[i] > macd_result.histogram[i-1]) {
-                    executeTrade(price_data[i], "BUY", "RSI Oversold + Uptrend + MACD Improving", 
-                               current_rsi, current_macd, current_signal);
-                    continue;
-                }
-            }
-            
-            // SELL SIGNALS
-            if (shares > 0) {
-                
-                // Signal 1: RSI overbought with MACD bearish
-                if (current_rsi > rsi_overbought && !macd_bullish) {
-                    executeTrade(price_data[i], "SELL", "RSI Overbought + MACD Bearish", 
-                               current_rsi, current_macd, current_signal);
-                    continue;
-                }
-                
-                // Signal 2: MACD bearish crossover
-                if (macd_crossover_down && current_rsi > 50) {
-                    executeTrade(price_data[i], "SELL", "MACD Bearish Crossover", 
-                               current_rsi, current_macd, current_signal);
-                    continue;
-                }
-                
-                // Signal 3: Trend reversal (SMA crossover down)
-                if (!uptrend && sma_20[i-1] > sma_50[i-1]) {  // Just crossed down
-                    executeTrade(price_data[i], "SELL", "Trend Reversal", 
-                               current_rsi, current_macd, current_signal);
-                    continue;
+        double worst = 0.0;
+        const char* worst_name = names[0];
+        for (int o = 0; o < OUTPUT_COUNT; ++o) {
+            for (size_t s = 0; s < symbols; ++s) {
+                for (size_t t = 0; t < bars; ++t) {
+                    double expected = reference[o][s][t];
+                    double error = fabs(outputs[o].at(t, s) - expected) / max(1.0, fabs(expected));
+                    if (!(error <= worst)) {
+                        worst = error;
+                        worst_name = names[o];
+                    }
                 }
             }
-            
-            // Record portfolio value
-            double portfolio_value = cash + shares * current_price;
-            TradingSignal signal;
-            signal.date = price_data[i].date;
-            signal.action = "HOLD";
-            signal.price = current_price;
-            signal.rsi = current_rsi;
-            signal.macd = current_macd;
-            signal.signal = current_signal;
-            signal.portfolio_value = portfolio_value;
-            signal.reason = "No signal";
-            trade_history.push_back(signal);
         }
         
-        cout << "\nBacktest completed!" << endl;
+        bool within = worst < 1e-9;
+        ok = ok && within;
+        cout << "  " << left << setw(8) << BatchIndicators::levelName(level) << right << " kernels: "
+             << setprecision(4) << seconds << "s  (" << setprecision(1) << reference_seconds / seconds
+             << "x)  max rel error " << scientific << setprecision(2) << worst << " [" << worst_name << "]"
+             << fixed << (within ? "" : "  EXCEEDS TOLERANCE") << endl;
+    }
+    BatchIndicators::setLevel(detected);
+    return ok ? 0 : 1;
+}
+
+// Benchmark suite: times CSV / .fsx loading, each TechnicalIndicators
+// function, the fused indicator pass, backtest and metrics on synthetic
+// series of increasing size. Loads are only timed up to --csv-max bars to
+// keep the temporary files small.
+static int runBenchSuite(const CommandLine& args) {
+    vector<size_t> sizes;
+    stringstream size_list(args.get("sizes", "250,2520,100000,1000000,10000000"));
+    string item;
+    while (getline(size_list, item, ',')) {
+        if (!item.empty()) sizes.push_back((size_t)max(60L, atol(item.c_str())));
     }
+    size_t csv_max = args.getCount("csv-max", 1000000);
+    double min_seconds = args.getDouble("min-time", 0.2);
     
-private:
-    void executeTrade(const PriceData& data, const string& action, const string& reason,
-                     double rsi, double macd, double signal_val) {
-        
-        TradingSignal trade_signal;
-        trade_signal.date = data.date;
-        trade_signal.action = action;
-        trade_signal.price = data.close;
-        trade_signal.rsi = rsi;
-        trade_signal.macd = macd;
-        trade_signal.signal = signal_val;
-        trade_signal.reason = reason;
-        
-        if (action == "BUY" && shares == 0 && cash > data.close) {
-            double investment = cash * position_size_pct;
-            shares = investment / data.close;
-            cash -= shares * data.close;
-            entry_price = data.close;
-            
-            cout << "BUY:  " << data.date << " at $" << fixed << setprecision(2) 
-                 << data.close << " - " << reason 
-                 << " (RSI: " << setprecision(1) << rsi << ")" << endl;
+    // Best time of repeated runs, repeating until min_seconds have elapsed
+    auto timeBest = [&](const function<void()>& fn) {
+        double best = 1e300, total = 0.0;
+        for (int r = 0; r < 1000 && (r == 0 || total < min_seconds); ++r) {
+            auto start = chrono::steady_clock::now();
+            fn();
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            best = min(best, seconds);
+            total += seconds;
         }
-        else if (action == "SELL" && shares > 0) {
-            double sale_proceeds = shares * data.close;
-            double profit = sale_proceeds - (shares * entry_price);
-            cash += sale_proceeds;
-            shares = 0;
-            
-            cout << "SELL: " << data.date << " at $" << fixed << setprecision(2) 
-                 << data.close << " - " << reason 
-                 << " (Profit: $" << profit << ")" << endl;
-            
-            entry_price = 0;
+        return best;
+    };
+    
+    ofstream csv_out;
+    if (args.has("out")) {
+        csv_out.open(args.get("out", "bench_results.csv").c_str());
+        if (!csv_out.is_open()) {
+            throw runtime_error("Cannot open output file: " + args.get("out", "bench_results.csv"));
         }
-        
-        trade_signal.portfolio_value = cash + shares * data.close;
-        trade_history.push_back(trade_signal);
+        csv_out << "bars,stage,seconds,bars_per_second" << "\n";
     }
     
-public:
-    void printPerformanceMetrics(const vector<PriceData>& price_data) {
-        if (trade_history.empty()) {
-            cout << "No trading history available." << endl;
-            return;
-        }
-        
-        double final_price = price_data.back().close;
-        double final_value = cash + shares * final_price;
-        double total_return = (final_value - initial_capital) / initial_capital;
-        double buy_hold_return = (final_price - price_data[0].close) / price_data[0].close;
-        
-        // Calculate trade statistics
-        int buy_trades = 0, sell_trades = 0, profitable_trades = 0;
-        double total_profit = 0.0;
-        double last_buy_price = 0.0;
-        
-        for (const auto& trade : trade_history) {
-            if (trade.action == "BUY") {
-                buy_trades++;
-                last_buy_price = trade.price;
-            } else if (trade.action == "SELL" && last_buy_price > 0) {
-                sell_trades++;
-                double profit = trade.price - last_buy_price;
-                total_profit += profit;
-                if (profit > 0) profitable_trades++;
-            }
+    cout << "Benchmark suite (best of repeated runs, at least " << min_seconds << "s per stage)" << endl;
+    cout << left << setw(12) << "Bars" << setw(14) << "Stage" << right << setw(12) << "Time ms"
+         << setw(14) << "Mbars/s" << endl;
+    auto report = [&](size_t bars, const char* stage, double seconds) {
+        cout << left << setw(12) << bars << setw(14) << stage << right << fixed
+             << setw(12) << setprecision(3) << seconds * 1000
+             << setw(14) << setprecision(2) << bars / seconds / 1e6 << endl;
+        if (csv_out.is_open()) {
+            csv_out << bars << "," << stage << "," << scientific << setprecision(6) << seconds << ","
+                    << bars / seconds << fixed << "\n";
         }
+    };
+    
+    namespace fs = std::filesystem;
+    for (size_t bars : sizes) {
+        PriceSeries series = SyntheticData::randomWalk(bars, 1);
         
-        double win_rate = buy_trades > 0 ? (double)profitable_trades / buy_trades * 100 : 0;
-        
-        // Calculate volatility and Sharpe ratio
-        vector<double> returns;
-        for (size_t i = 1; i < trade_history.size(); ++i) {
-            double prev_val = trade_history[i-1].portfolio_value;
-            double curr_val = trade_history[i].portfolio_value;
-            if (prev_val > 0) {
-                returns.push_back((curr_val - prev_val) / prev_val);
+        if (bars <= csv_max) {
+            string csv_path = (fs::temp_directory_path() / "finsimx_bench.csv").string();
+            string fsx_path = (fs::temp_directory_path() / "finsimx_bench.fsx").string();
+            {
+                ofstream file(csv_path.c_str());
+                file << "Date,Open,High,Low,Close,Volume" << "\n";
+                char row[160];
+                for (size_t i = 0; i < bars; ++i) {
+                    snprintf(row, sizeof(row), "%s,%.6f,%.6f,%.6f,%.6f,%.0f\n",
+                             Timestamp::format(series.timestamp[i]).c_str(), series.open[i],
+                             series.high[i], series.low[i], series.close[i], series.volume[i]);
+                    file << row;
+                }
             }
+            BinaryPriceFile::write(series.view(), fsx_path);
+            report(bars, "csv load", timeBest([&] { FastCSVParser::loadPriceData(csv_path); }));
+            report(bars, "fsx load", timeBest([&] { PriceLoader::loadPriceData(fsx_path); }));
+            fs::remove(csv_path);
+            fs::remove(fsx_path);
         }
         
-        double avg_return = 0.0;
-        for (double ret : returns) avg_return += ret;
-        avg_return /= returns.size();
+        PriceView price_data = series.view();
+        Span<double> close = series.close;
+        report(bars, "SMA20", timeBest([&] { TechnicalIndicators::calculateSMA(close, 20); }));
+        report(bars, "EMA12", timeBest([&] { TechnicalIndicators::calculateEMA(close, 12); }));
+        report(bars, "RSI14", timeBest([&] { TechnicalIndicators::calculateRSI(close, 14); }));
+        report(bars, "MACD", timeBest([&] { TechnicalIndicators::calculateMACD(close); }));
+        report(bars, "Bollinger", timeBest([&] { TechnicalIndicators::calculateBollingerBandsFull(close); }));
         
-        double variance = 0.0;
-        for (double ret : returns) {
-            variance += (ret - avg_return) * (ret - avg_return);
-        }
-        double std_dev = sqrt(variance / returns.size());
-        double sharpe = std_dev > 0 ? (avg_return * 252) / (std_dev * sqrt(252)) : 0;
+        IndicatorSet indicators;
+        report(bars, "indicators", timeBest([&] {
+            indicators = TechnicalIndicators::calculateStrategyIndicators(price_data);
+        }));
         
-        // Maximum drawdown
-        double peak = initial_capital;
-        double max_drawdown = 0.0;
-        for (const auto& trade : trade_history) {
-            peak = max(peak, trade.portfolio_value);
-            double drawdown = (peak - trade.portfolio_value) / peak;
-            max_drawdown = max(max_drawdown, drawdown);
-        }
+        AdvancedTradingStrategy strategy;
+        strategy.setVerbose(false);
+        report(bars, "backtest", timeBest([&] {
+            strategy.reset(100000.0, StrategyParams());
+            strategy.backtest(price_data, indicators);
+        }));
         
-        cout << "\n" << string(60, '=') << endl;
-        cout << "ADVANCED TRADING STRATEGY RESULTS" << endl;
-        cout << string(60, '=') << endl;
-        cout << fixed << setprecision(2);
-        cout << "Initial Capital:        $" << initial_capital << endl;
-        cout << "Final Portfolio:        $" << final_value << endl;
-        cout << "Total Return:           " << (total_return * 100) << "%" << endl;
-        cout << "Buy & Hold Return:      " << (buy_hold_return * 100) << "%" << endl;
-        cout << "Alpha (Excess Return):  " << ((total_return - buy_hold_return) * 100) << "%" << endl;
-        cout << "Sharpe Ratio:           " << setprecision(3) << sharpe << endl;
-        cout << "Max Drawdown:           " << setprecision(2) << (max_drawdown * 100) << "%" << endl;
-        cout << "Total Buy Trades:       " << buy_trades << endl;
-        cout << "Total Sell Trades:      " << sell_trades << endl;
-        cout << "Win Rate:               " << win_rate << "%" << endl;
-        cout << "Current Position:       " << (shares > 0 ? "LONG" : "CASH") << endl;
-        cout << "Cash Remaining:         $" << cash << endl;
-        if (shares > 0) {
-            cout << "Shares Held:            " << setprecision(0) << shares << endl;
-            cout << "Unrealized P&L:         $" << setprecision(2) << (shares * (final_price - entry_price)) << endl;
+        // The backtest already accumulates its metrics, so time that streaming
+        // pass on its own over the run's equity curve
+        const TradeLog& log = strategy.getTradeLog();
+        const vector<double>& equity = log.equity();
+        vector<double> market_value(equity.size(), 0.0);
+        size_t offset = bars - equity.size();
+        for (size_t f = 0; f < log.fills().size(); ++f) {
+            const TradingSignal& fill = log.fills()[f];
+            if (fill.action != TradeAction::Buy) continue;
+            size_t exit = f + 1 < log.fills().size() ? log.fills()[f + 1].bar : bars;
+            for (size_t i = fill.bar; i < exit; ++i) market_value[i - offset] = equity[i - offset];
         }
+        MetricsAccumulator accumulator;
+        report(bars, "metrics", timeBest([&] {
+            accumulator.reset(100000.0);
+            for (size_t i = 0; i < equity.size(); ++i) accumulator.addBar(equity[i], market_value[i]);
+        }));
+    }
+    return 0;
+}
 
+static int runDefaultMode(const CommandLine& args) {
+    cout << "Advanced Trading Strategy - Multi-Indicator System" << endl;
+    cout << string(60, '=') << endl;
+    
+    // Load price data
+    cout << "Loading price data from 'prices.csv'..." << endl;
+    PriceSeries series;
+    IndicatorSet indicators;
+    if (args.has("cache")) {
+        CachedPrices cached = IndicatorCache::load("prices.csv", args.get("cache"));
+        series = std::move(cached.series);
+        indicators = std::move(cached.indicators);
+        cout << "Indicator cache: " << cached.cached_rows << " rows restored, " << cached.parsed_rows
+             << " parsed" << (cached.rebuilt ? " (rebuilt)" : "") << endl;
+    } else {
+        series = FastCSVParser::loadPriceSeries("prices.csv");
+        IndicatorEngine().compute(series.view(), indicators);
     }
-};
+    PriceView price_data = series.view();
+    cout << "Successfully loaded " << price_data.size() << " price records." << endl;
+    
+    // Initialize and run strategy
+    AdvancedTradingStrategy strategy(100000.0, loadStrategyParams(args));
+    strategy.setPrintTrades(args.has("print-trades"));
+    strategy.backtest(price_data, indicators);
+    strategy.printPerformanceMetrics(price_data);
+    
+    if (args.has("trades")) {
+        ResultSinkConfig outputs;
+        outputs.trades_csv = args.get("trades");
+        ResultSink sink(1, vector<string>(1, "prices"), outputs);
+        for (const auto& fill : strategy.getTradeLog().fills()) sink.pushFill(0, 0, fill);
+        sink.close();
+        cout << "Wrote " << strategy.getTradeLog().fills().size() << " trades to " << outputs.trades_csv << endl;
+    }
+    return 0;
+}
+
+static int runSelectedMode(const CommandLine& args) {
+    if (args.has("batch")) {
+        return runBatchMode(args);
+    }
+    if (args.has("sweep")) {
+        return runSweepMode(args);
+    }
+    if (args.has("walk-forward")) {
+        return runWalkForwardMode(args);
+    }
+    if (args.has("portfolio")) {
+        return runPortfolioMode(args);
+    }
+    if (args.has("monte-carlo")) {
+        return runMonteCarloMode(args);
+    }
+    if (args.has("execute")) {
+        return runExecutionMode(args);
+    }
+    if (args.has("resample")) {
+        return runResampleMode(args);
+    }
+    if (args.has("replay")) {
+        return runReplayMode(args);
+    }
+    if (args.has("convert")) {
+        return runConvertMode(args);
+    }
+    if (args.has("bench")) {
+        return runBenchSuite(args);
+    }
+    if (args.has("bench-simd")) {
+        return runSimdBenchmark(args);
+    }
+    if (args.has("check-rolling")) {
+        return runRollingCheckMode(args);
+    }
+    if (args.has("bench-csv")) {
+        return runCsvBenchmark(args);
+    }
+    return runDefaultMode(args);
+}
 
-int main() {
+int main(int argc, char* argv[]) {
     try {
-        cout << "Advanced Trading Strategy - Multi-Indicator System" << endl;
-        cout << string(60, '=') << endl;
-        
-        // Load price data
-        cout << "Loading price data from 'prices.csv'..." << endl;
-        vector<PriceData> price_data = CSVParser::loadPriceData("prices.csv");
-        cout << "Successfully loaded " << price_data.size() << " price records." << endl;
-        
-        // Initialize and run strategy
-        AdvancedTradingStrategy strategy(100000.0);
-        strategy.backtest(price_data);
-        strategy.printPerformanceMetrics(price_data);
+        CommandLine args(argc, argv);
+        Profiler::setEnabled(args.has("profile"));
+        int status = runSelectedMode(args);
+        if (Profiler::enabled()) {
+            Profiler::report(cout);
+        }
+        return status;
         
     } catch (const exception& e) {
         cerr << "Error: " << e.what() << endl;
-        
+        return 1;
     }
-    
-    return 0;
 }
\ No newline at end of file